@@ -0,0 +1,215 @@
+// message_log.js
+// Append-only, segmented message log; same on-disk format as message_log.hpp.
+//
+// Segments ("00000001.log", ...) are files sized up front that start with the
+// 16-byte header "CHATLOG1" + u64 highest sequence in the older segments (or
+// 0). Records (big-endian):
+//   u32 size (header included, 0 = end of segment), u32 CRC-32 of bytes
+//   [8, size), u64 sequence, u64 time in ms, u8 type, u8 room length,
+//   u16 reserved, room name, message line.
+//
+// Notices are logged as well as chat lines so that lastSequence, the highest
+// of the newest segment's header and records (or, if it has neither, of the
+// older segments), never lets a restarted server reissue a number.
+//
+// Node cannot map files into memory, so records are collected in memory and
+// written to the segment every syncMs with one positioned write
+// and one fdatasync (group commit): no write syscall per message, and the
+// event loop never waits for the disk.
+const fs = require('fs');
+const path = require('path');
+
+const SEGMENT_HEADER = 16;
+const RECORD_HEADER = 28;
+const MAGIC = Buffer.from('CHATLOG1');
+const LOG_CHAT = 1;
+const LOG_NOTICE = 2;
+
+const CRC_TABLE = new Int32Array(256);
+for (let i = 0; i < 256; i++) {
+  let c = i;
+  for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+  CRC_TABLE[i] = c;
+}
+
+// CRC-32 (IEEE, as used by zlib)
+function crc32(buf) {
+  let crc = -1;
+  for (let i = 0; i < buf.length; i++) crc = CRC_TABLE[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  return (crc ^ -1) >>> 0;
+}
+
+function encodeRecord(seq, timeMs, room, text, type, maxText) {
+  const roomBytes = Buffer.from(room, 'utf8').subarray(0, 255);
+  let textBytes = Buffer.from(text, 'utf8');
+  if (textBytes.length > maxText) textBytes = textBytes.subarray(0, maxText);
+  const size = RECORD_HEADER + roomBytes.length + textBytes.length;
+  const rec = Buffer.alloc(size);
+  rec.writeUInt32BE(size, 0);
+  rec.writeBigUInt64BE(BigInt(seq), 8);
+  rec.writeBigUInt64BE(BigInt(timeMs), 16);
+  rec[24] = type;
+  rec[25] = roomBytes.length;
+  roomBytes.copy(rec, RECORD_HEADER);
+  textBytes.copy(rec, RECORD_HEADER + roomBytes.length);
+  rec.writeUInt32BE(crc32(rec.subarray(8)), 4);
+  return rec;
+}
+
+function headerSequence(buf) {
+  return buf.subarray(0, MAGIC.length).equals(MAGIC) ? Number(buf.readBigUInt64BE(8)) : 0;
+}
+
+// Size of the valid record at offset, or 0 at the end / on a torn record
+function recordSize(buf, offset) {
+  if (buf.length - offset < RECORD_HEADER) return 0;
+  const size = buf.readUInt32BE(offset);
+  if (size < RECORD_HEADER || size > buf.length - offset || RECORD_HEADER + buf[offset + 25] > size) return 0;
+  if (crc32(buf.subarray(offset + 8, offset + size)) !== buf.readUInt32BE(offset + 4)) return 0;
+  return size;
+}
+
+class MessageLog {
+  constructor(dir, segmentBytes, syncMs) {
+    this.dir = dir;
+    this.segmentBytes = segmentBytes;
+    this.lastSequence = 0; // Highest sequence in the log at startup
+    this.batch = [];       // Encoded records waiting for the next group commit
+    this.writing = false;
+    fs.mkdirSync(dir, { recursive: true });
+
+    const segments = fs.readdirSync(dir).filter((f) => /^\d{8}\.log$/.test(f)).sort();
+    const newest = segments.length ? parseInt(segments[segments.length - 1], 10) : 1;
+    this.openSegment(newest);
+    if (segments.length) this.recover();
+    this.writtenSeq = this.lastSequence; // Goes into the next segment's header
+
+    this.timer = setInterval(() => this.flush(), syncMs);
+    this.timer.unref();
+  }
+
+  openSegment(index) {
+    const file = path.join(this.dir, `${String(index).padStart(8, '0')}.log`);
+    this.index = index;
+    this.fd = fs.openSync(file, fs.existsSync(file) ? 'r+' : 'w+');
+    const size = fs.fstatSync(this.fd).size;
+    if (size === 0) {
+      const header = Buffer.alloc(SEGMENT_HEADER);
+      MAGIC.copy(header);
+      header.writeBigUInt64BE(BigInt(this.writtenSeq || 0), 8);
+      fs.writeSync(this.fd, header, 0, SEGMENT_HEADER, 0);
+    }
+    this.size = Math.max(size, this.segmentBytes); // Existing segments keep their size
+    if (size < this.size) fs.ftruncateSync(this.fd, this.size);
+    this.offset = SEGMENT_HEADER;
+  }
+
+  // Finds the end of the newest segment and clears any torn tail
+  recover() {
+    const buf = fs.readFileSync(this.fd);
+    this.lastSequence = headerSequence(buf);
+    let size;
+    while ((size = recordSize(buf, this.offset)) > 0) {
+      const seq = Number(buf.readBigUInt64BE(this.offset + 8));
+      if (seq > this.lastSequence) this.lastSequence = seq;
+      this.offset += size;
+    }
+    // An empty segment without a header sequence (an older format, or a
+    // switch that crashed): the numbering continues from the segments before
+    for (let index = this.index - 1; this.lastSequence === 0 && index > 0; index--) {
+      const base = this.scanSegment(index, (seq) => {
+        if (seq > this.lastSequence) this.lastSequence = seq;
+      });
+      if (base > this.lastSequence) this.lastSequence = base;
+    }
+    // Nothing stale may follow the next record
+    if (buf.subarray(this.offset).some((b) => b !== 0)) {
+      fs.writeSync(this.fd, Buffer.alloc(buf.length - this.offset), 0, buf.length - this.offset, this.offset);
+      fs.fdatasyncSync(this.fd);
+    }
+  }
+
+  // Calls fn(seq, room, text, type) for every valid record of a segment;
+  // returns its header sequence (0 if it cannot be read)
+  scanSegment(index, fn) {
+    let buf;
+    try {
+      buf = fs.readFileSync(path.join(this.dir, `${String(index).padStart(8, '0')}.log`));
+    } catch (err) {
+      return 0;
+    }
+    if (buf.length < SEGMENT_HEADER) return 0;
+    let size;
+    for (let offset = SEGMENT_HEADER; (size = recordSize(buf, offset)) > 0; offset += size) {
+      const roomEnd = offset + RECORD_HEADER + buf[offset + 25];
+      fn(Number(buf.readBigUInt64BE(offset + 8)), buf.toString('utf8', offset + RECORD_HEADER, roomEnd),
+        buf.toString('utf8', roomEnd, offset + size), buf[offset + 24]);
+    }
+    return headerSequence(buf);
+  }
+
+  // Calls fn(seq, room, text, type) for the records in the newest segments,
+  // oldest first, reading at most maxBytes of segments (always the newest
+  // one). Meant for startup, before anything is appended.
+  forEachRecentRecord(maxBytes, fn) {
+    const sizeOf = (index) => {
+      try {
+        return fs.statSync(path.join(this.dir, `${String(index).padStart(8, '0')}.log`)).size;
+      } catch (err) {
+        return -1;
+      }
+    };
+    let first = this.index;
+    let bytes = this.size;
+    for (let size; first > 1 && (size = sizeOf(first - 1)) >= 0 && bytes + size <= maxBytes; first--) {
+      bytes += size;
+    }
+    for (let index = first; index <= this.index; index++) this.scanSegment(index, fn);
+  }
+
+  // Queues one message (a chat line unless notice) for the next group commit
+  append(seq, room, text, notice = false) {
+    const maxText = this.segmentBytes - SEGMENT_HEADER - RECORD_HEADER - 255;
+    this.batch.push(encodeRecord(seq, Date.now(), room, text, notice ? LOG_NOTICE : LOG_CHAT, maxText));
+  }
+
+  // Group commit: one write + one fdatasync for everything queued
+  flush() {
+    if (this.writing || this.batch.length === 0) return;
+    const records = this.batch;
+    this.batch = [];
+    this.writing = true;
+
+    // Records that fit in the current segment go out now; the rest after a switch
+    let bytes = 0;
+    let count = 0;
+    while (count < records.length && this.offset + bytes + records[count].length <= this.size) {
+      const seq = Number(records[count].readBigUInt64BE(8));
+      if (seq > this.writtenSeq) this.writtenSeq = seq;
+      bytes += records[count++].length;
+    }
+    const rest = records.slice(count);
+    const done = (err) => {
+      if (err) console.log('Message log write failed:', err.message);
+      this.writing = false;
+      if (rest.length) {
+        fs.closeSync(this.fd);
+        this.openSegment(this.index + 1);
+        this.batch = rest.concat(this.batch);
+        this.flush();
+      }
+    };
+    if (count === 0) {
+      done(null);
+      return;
+    }
+    const position = this.offset;
+    this.offset += bytes;
+    fs.write(this.fd, Buffer.concat(records.slice(0, count), bytes), 0, bytes, position, (err) => {
+      if (err) done(err);
+      else fs.fdatasync(this.fd, done);
+    });
+  }
+}
+
+module.exports = { MessageLog, LOG_CHAT };
@@ -0,0 +1,71 @@
+// metrics.js
+// Prometheus text exposition for GET /metrics; same names, help texts and
+// histogram buckets as server_metrics.hpp, so dashboards work against
+// either server. Node runs the whole chat server on one thread, so there is
+// a single shard of plain numbers; per-message updates are one increment.
+// Rates such as logins per second come from the counters
+// (rate(chat_logins_total[1m])).
+
+// Upper bounds of chat_broadcast_fanout_seconds, in ns and as "le" labels
+const BOUNDS_NS = [
+  1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+  500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000,
+];
+const LABELS = [
+  '1e-06', '2.5e-06', '5e-06', '1e-05', '2.5e-05', '5e-05', '0.0001', '0.00025',
+  '0.0005', '0.001', '0.0025', '0.005', '0.01', '0.025', '0.05', '0.1',
+];
+
+// [name, type, help], in exposition order
+const METRICS = [
+  ['chat_connections', 'gauge', 'Open TCP connections.'],
+  ['chat_sessions', 'gauge', 'Logged-in chat sessions.'],
+  ['chat_logins_total', 'counter', 'Successful logins.'],
+  ['chat_messages_received_total', 'counter', 'Lines or frames received from clients.'],
+  ['chat_messages_sent_total', 'counter', 'Messages queued to clients.'],
+  ['chat_bytes_received_total', 'counter', 'Bytes received from clients.'],
+  ['chat_bytes_sent_total', 'counter', 'Bytes written to client sockets.'],
+  ['chat_output_queue_bytes', 'gauge', 'Bytes waiting in client output queues.'],
+  ['chat_congested_clients', 'gauge', 'Clients above the output high watermark.'],
+  ['chat_messages_dropped_total', 'counter', 'Broadcasts withheld from slow consumers.'],
+  ['chat_slow_consumer_disconnects_total', 'counter', 'Clients disconnected for falling behind.'],
+  ['chat_compression_plain_bytes_total', 'counter', 'Frames sent to +z clients, counted as if uncompressed.'],
+  ['chat_compression_sent_bytes_total', 'counter', 'Frames sent to +z clients, as sent.'],
+];
+
+class DurationHistogram {
+  constructor() {
+    this.counts = new Array(BOUNDS_NS.length + 1).fill(0); // Per bucket, not cumulative
+    this.sumNs = 0;
+  }
+
+  observe(ns) {
+    let i = 0;
+    while (i < BOUNDS_NS.length && ns > BOUNDS_NS[i]) i++;
+    this.counts[i]++; // counts[BOUNDS_NS.length]: above the last bound
+    this.sumNs += ns;
+  }
+}
+
+function header(name, type, help) {
+  return `# HELP ${name} ${help}\n# TYPE ${name} ${type}\n`;
+}
+
+// values: metric name -> number; fanout: DurationHistogram of broadcasts
+function renderMetrics(values, fanout) {
+  let out = '';
+  for (const [name, type, help] of METRICS) out += header(name, type, help) + `${name} ${values[name] || 0}\n`;
+
+  const name = 'chat_broadcast_fanout_seconds';
+  out += header(name, 'histogram', "Time to deliver one broadcast to a room's members.");
+  let cumulative = 0;
+  for (let i = 0; i <= BOUNDS_NS.length; i++) {
+    cumulative += fanout.counts[i];
+    out += `${name}_bucket{le="${i < LABELS.length ? LABELS[i] : '+Inf'}"} ${cumulative}\n`;
+  }
+  out += `${name}_sum ${(fanout.sumNs / 1e9).toFixed(9)}\n`;
+  out += `${name}_count ${cumulative}\n`;
+  return out;
+}
+
+module.exports = { DurationHistogram, renderMetrics };
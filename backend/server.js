@@ -1,85 +1,657 @@
 // server.js
 const express = require('express');
+const fs = require('fs');
 const net = require('net');
+const path = require('path');
+const { StringDecoder } = require('string_decoder');
+const zlib = require('zlib');
+const { MessageLog, LOG_CHAT } = require('./message_log');
+const { DurationHistogram, renderMetrics } = require('./metrics');
+const { UserDirectory, parseQuery, matchesEtag } = require('./user_directory');
 
 const app = express();
-const HTTP_PORT = 3000;
-const TCP_PORT = 4000;
+const HTTP_PORT = parseInt(process.env.HTTP_PORT, 10) || 3000;
+const TCP_PORT = parseInt(process.env.TCP_PORT, 10) || 4000;
+const UNIX_SOCKET = process.env.UNIX_SOCKET || '';
+
+// Optional binary framing (see binary_frame.hpp): "LOGIN <username> +bin"
+// switches a connection to length-prefixed frames after LOGIN_OK.
+// Header: u32 length, u8 type, u8 flags, u16 reserved, u64 sequence (big-endian)
+const BINARY_CAPABILITY = '+bin';
+const FRAME_HEADER_SIZE = 16;
+const MAX_FRAME_PAYLOAD = 1 << 20;
+const FRAME_TEXT = 1;
+
+// Per-message compression (see message_compression.hpp): "+z" next to "+bin"
+// gets broadcasts as TEXT frames with FRAME_FLAG_DEFLATE set, raw deflate
+// against CHAT_DICTIONARY (byte-identical to the C++ copy). Each broadcast
+// is compressed once and that frame is shared by every "+z" member.
+const COMPRESSION_CAPABILITY = '+z';
+const FRAME_FLAG_DEFLATE = 0x01;
+const CHAT_DICTIONARY = Buffer.from(
+  'ERROR Usage: /msg <user> <text>ERROR No such user: ERROR Room names are ' +
+  ' messages were skipped because your connection fell behind' +
+  'PART_OK JOIN_OK HISTORY WHISPER to WHISPER from ' +
+  'sorry please thank you thanks what when where why how yes no okay ok sure ' +
+  'hello hi hey good morning night lol haha :) ' +
+  'is it that this have with for not are was you the and ' +
+  ' has left #lobby has joined #lobby' +
+  ' has left the chatSERVER:  has joined the chatSERVER: '
+);
+// Logged-in "+z" sessions; broadcasts are only compressed while there are any
+let compressedSessions = 0;
+
+// Session resume (see session_resume.hpp): "+seq=<n>" numbers text
+// broadcasts ("#<seq> <line>") and limits the LOGIN scrollback to messages
+// after <n>; "+room=<room>" logs straight into that room.
+const SEQUENCE_CAPABILITY = '+seq';
+const SEQUENCE_TOKEN = /^\+seq=(\d{1,19})$/;
+const ROOM_TOKEN = /^\+room=(.+)$/;
+
+// Durable message history (see message_log.js): every chat message is
+// appended to segment files in MESSAGE_LOG_DIR ("off" disables the log).
+const MESSAGE_LOG_DIR = process.env.MESSAGE_LOG_DIR || path.join(__dirname, 'messages');
+const MESSAGE_LOG_SEGMENT_MB = Math.max(4, parseInt(process.env.MESSAGE_LOG_SEGMENT_MB, 10) || 64);
+const MESSAGE_LOG_SYNC_MS = parseInt(process.env.MESSAGE_LOG_SYNC_MS, 10) || 20;
+const messageLog = MESSAGE_LOG_DIR === 'off'
+  ? null
+  : new MessageLog(MESSAGE_LOG_DIR, MESSAGE_LOG_SEGMENT_MB << 20, MESSAGE_LOG_SYNC_MS);
+if (messageLog) console.log(`Message log in ${MESSAGE_LOG_DIR} (last sequence ${messageLog.lastSequence})`);
+
+// Sequence numbers continue across restarts when the log is on
+let broadcastSeq = messageLog ? messageLog.lastSequence : 0;
+
+// text: a string, or a Buffer holding the payload as is
+function encodeFrame(type, seq, text, flags = 0) {
+  const payload = Buffer.isBuffer(text) ? text : Buffer.from(text, 'utf8');
+  const frame = Buffer.alloc(FRAME_HEADER_SIZE + payload.length);
+  frame.writeUInt32BE(payload.length, 0);
+  frame[4] = type;
+  frame[5] = flags;
+  frame.writeBigUInt64BE(BigInt(seq), 8);
+  payload.copy(frame, FRAME_HEADER_SIZE);
+  return frame;
+}
+
+// Compresses a message into a "+z" frame; null if it would not get smaller
+function deflatedFrame(seq, text) {
+  const plain = Buffer.from(text, 'utf8');
+  const packed = zlib.deflateRawSync(plain, { dictionary: CHAT_DICTIONARY });
+  return packed.length < plain.length ? encodeFrame(FRAME_TEXT, seq, packed, FRAME_FLAG_DEFLATE) : null;
+}
+
+// Accounts for a frame of text sent to a "+z" client as sentBytes
+function countCompressed(info, text, sentBytes) {
+  const stats = info.compression;
+  const plainBytes = FRAME_HEADER_SIZE + Buffer.byteLength(text, 'utf8');
+  stats.frames++;
+  stats.plainBytes += plainBytes;
+  stats.sentBytes += sentBytes;
+  counters.compressedPlainBytes += plainBytes;
+  counters.compressedSentBytes += sentBytes;
+}
+
+function describeCompression(stats) {
+  const ratio = stats.sentBytes ? stats.plainBytes / stats.sentBytes : 1;
+  return `${stats.frames} frames, ${stats.plainBytes} -> ${stats.sentBytes} bytes (${ratio.toFixed(2)}x)`;
+}
+
+// Slow consumers: once a socket has OUTPUT_HIGH_WATER bytes waiting in
+// Node's write buffer, broadcasts to it are dropped, coalesced into one
+// "skipped" notice, or the socket is disconnected (SLOW_CLIENT_POLICY),
+// until it drains to OUTPUT_LOW_WATER. This keeps memory bounded.
+const SLOW_CLIENT_POLICY = process.env.SLOW_CLIENT_POLICY || 'coalesce'; // drop | coalesce | disconnect
+const OUTPUT_HIGH_WATER = parseInt(process.env.OUTPUT_HIGH_WATER, 10) || 256 * 1024;
+const OUTPUT_LOW_WATER = Math.min(parseInt(process.env.OUTPUT_LOW_WATER, 10) || 64 * 1024, OUTPUT_HIGH_WATER);
+if (!['drop', 'coalesce', 'disconnect'].includes(SLOW_CLIENT_POLICY)) {
+  console.error('SLOW_CLIENT_POLICY must be drop, coalesce or disconnect');
+  process.exit(1);
+}
+// Slow-consumer actions since startup
+const backpressure = { dropped: 0, coalesced: 0, disconnected: 0 };
+
+// Counters for GET /metrics (see metrics.js). They are updated as bytes are
+// queued, written and dropped, so a scrape costs the same however many
+// clients are connected.
+// Every open connection, logged in or not -> { queued, flushed }: the bytes
+// it had queued when last looked at, and the write callback that looks again
+const sockets = new Map();
+const counters = {
+  logins: 0,
+  messagesIn: 0,
+  messagesOut: 0,
+  bytesIn: 0,
+  bytesOut: 0,
+  queuedBytes: 0,
+  congested: 0, // Clients above the high watermark
+  compressedPlainBytes: 0,
+  compressedSentBytes: 0,
+};
+const fanout = new DurationHistogram();
+
+// Brings the byte counters up to date for one socket: of the bytes it took
+// since it was last looked at (accepted), whatever is not queued was written.
+// A destroyed socket has thrown its queue away (writableLength drops to 0
+// without a byte being sent), so its counters stay as they were until 'close'.
+function account(socket, accepted = 0) {
+  const out = sockets.get(socket);
+  if (!out || socket.destroyed) return;
+  const queued = socket.writableLength;
+  counters.queuedBytes += queued - out.queued;
+  counters.bytesOut += accepted - (queued - out.queued);
+  out.queued = queued;
+}
+
+// Queues data (a Buffer) for one socket; every write to a client goes through here
+function writeTo(socket, data) {
+  if (socket.destroyed) return;
+  counters.messagesOut++;
+  const out = sockets.get(socket);
+  socket.write(data, out && out.flushed);
+  account(socket, data.length);
+}
+
+// Fixed replies, encoded once and shared by every connection
+const WELCOME = Buffer.from('WELCOME: send "LOGIN <username>" to join\n');
+const LOGIN_REQUIRED = Buffer.from('ERROR You must login first with: LOGIN <username>\n');
 
 // Keep track of connected clients
-// Map socket -> { username, socket }
+// Map socket -> { username, socket, binary, numbered, compressed, compression,
+//                congested, skipped, room }
 const clients = new Map();
 
-// Helper broadcast function
-function broadcast(senderSocket, message) {
-  for (const [sock, info] of clients.entries()) {
-    if (sock !== senderSocket) {
-      sock.write(message + '\n');
+// Username index for /msg (see user_index.hpp): Map username -> array of
+// client infos in login order. Names may be logged in more than once; a
+// whisper goes to the most recent session, and a disconnect only removes
+// its own entry, so the index always matches who is online.
+const usersByName = new Map();
+// Sorted, versioned copy of who is online (and where) for GET /users
+const directory = new UserDirectory();
+
+function indexUser(info) {
+  const sessions = usersByName.get(info.username);
+  if (sessions) sessions.push(info);
+  else usersByName.set(info.username, [info]);
+  directory.add(info.username);
+}
+
+function unindexUser(info) {
+  directory.remove(info.username);
+  const sessions = usersByName.get(info.username);
+  const i = sessions.indexOf(info);
+  if (i !== -1) sessions.splice(i, 1);
+  if (sessions.length === 0) usersByName.delete(info.username);
+}
+
+// Splits "<user> <text>" or "\"<user name>\" <text>"; null if malformed
+function splitRecipient(arg) {
+  let name;
+  let end;
+  if (arg.startsWith('"')) {
+    end = arg.indexOf('"', 1);
+    if (end === -1) return null;
+    name = arg.slice(1, end);
+    end++;
+  } else {
+    end = arg.indexOf(' ');
+    if (end === -1) end = arg.length;
+    name = arg.slice(0, end);
+  }
+  const body = arg.slice(end).trim();
+  return name && body ? { name, body } : null;
+}
+
+// Handles "/msg <user> <text>" from info
+function whisper(info, arg) {
+  const parts = splitRecipient(arg);
+  if (!parts) {
+    sendLine(info, 'ERROR Usage: /msg <user> <text>');
+    return;
+  }
+  const sessions = usersByName.get(parts.name);
+  if (!sessions) {
+    sendLine(info, `ERROR No such user: ${parts.name}`);
+    return;
+  }
+  const target = sessions[sessions.length - 1];
+  if (admitBroadcast(target)) sendDirect(target, `WHISPER from ${info.username}: ${parts.body}`);
+  sendLine(info, `WHISPER to ${parts.name}: ${parts.body}`);
+}
+
+// Rooms (see chat_rooms.hpp): every user is in exactly one room, starting in
+// DEFAULT_ROOM. Map room name -> Set of client infos, so a message only
+// touches the sockets of its own room. Empty rooms are deleted.
+const DEFAULT_ROOM = 'lobby';
+const MAX_ROOM_NAME = 32;
+const ROOM_NAME = new RegExp(`^[A-Za-z0-9_-]{1,${MAX_ROOM_NAME}}$`);
+const rooms = new Map();
+
+function enterRoom(info, room) {
+  let members = rooms.get(room);
+  if (!members) rooms.set(room, (members = new Set()));
+  members.add(info);
+  info.room = room;
+  directory.enterRoom(info.username, room);
+}
+
+function leaveRoom(info) {
+  const members = rooms.get(info.room);
+  members.delete(info);
+  if (members.size === 0) rooms.delete(info.room);
+  directory.leaveRoom(info.username, info.room);
+}
+
+// Moves a client to another room and notifies both rooms
+function switchRoom(info, room) {
+  if (info.room === room) return;
+  const old = info.room;
+  leaveRoom(info);
+  broadcast(info.socket, old, `SERVER: ${info.username} has left #${old}`);
+  enterRoom(info, room);
+  broadcast(info.socket, room, `SERVER: ${info.username} has joined #${room}`);
+}
+
+// Sends one line in whatever framing the client negotiated
+function sendLine(info, text) {
+  writeTo(info.socket, encodeLine(info, text));
+}
+
+// A direct message: deflated for "+z" clients when that makes it smaller
+function sendDirect(info, text) {
+  if (!info.compressed) {
+    sendLine(info, text);
+    return;
+  }
+  const frame = deflatedFrame(0, text) || encodeFrame(FRAME_TEXT, 0, text);
+  countCompressed(info, text, frame.length);
+  writeTo(info.socket, frame);
+}
+
+// seq: broadcast sequence for frames and "+seq" text clients (0 for direct replies)
+function encodeLine(info, text, seq = 0) {
+  if (info.binary) return encodeFrame(FRAME_TEXT, seq, text);
+  return Buffer.from(info.numbered && seq ? `#${seq} ${text}\n` : text + '\n', 'utf8');
+}
+
+// Scrollback: the last SCROLLBACK chat messages of each room, replayed as
+// "HISTORY <n>" plus n lines right after LOGIN_OK / JOIN_OK (chat_rooms.hpp).
+// Each ring's slots are allocated once; recording a message only overwrites
+// the oldest slot's fields. Only the SCROLLBACK_ROOMS most recently written
+// rooms keep theirs (same limit as the native server).
+const SCROLLBACK = Math.max(0, parseInt(process.env.SCROLLBACK ?? '50', 10) || 0);
+const SCROLLBACK_ROOMS = 1024;
+const scrollback = new Map(); // room -> { slots, next, count }, least recently written first
+
+function remember(room, seq, text, deflated) {
+  if (SCROLLBACK === 0) return;
+  let ring = scrollback.get(room);
+  if (ring) {
+    scrollback.delete(room); // Re-inserted below as the most recently written
+  } else {
+    if (scrollback.size >= SCROLLBACK_ROOMS) scrollback.delete(scrollback.keys().next().value);
+    ring = {
+      slots: Array.from({ length: SCROLLBACK }, () => ({ seq: 0, text: '', deflated: null })),
+      next: 0,
+      count: 0,
+    };
+  }
+  scrollback.set(room, ring);
+  const slot = ring.slots[ring.next];
+  slot.seq = seq;
+  slot.text = text;
+  slot.deflated = deflated;
+  ring.next = (ring.next + 1) % SCROLLBACK;
+  if (ring.count < SCROLLBACK) ring.count++;
+}
+
+// After a restart, the scrollback is rebuilt from the newest log segments
+// (at most SCROLLBACK_RESTORE_MB of them)
+const SCROLLBACK_RESTORE_MB = 256;
+if (messageLog && SCROLLBACK > 0) {
+  let restored = 0;
+  messageLog.forEachRecentRecord(SCROLLBACK_RESTORE_MB << 20, (seq, room, text, type) => {
+    if (type !== LOG_CHAT) return;
+    remember(room, seq, text, null);
+    restored++;
+  });
+  console.log(`Scrollback restored from ${restored} logged messages`);
+}
+
+// Sends reply (already encoded) and the room's scrollback in one write;
+// since limits the replay to later messages ("+seq=<n>" resume)
+function sendWithScrollback(info, reply, since = 0) {
+  const ring = scrollback.get(info.room);
+  const lines = [];
+  if (ring) {
+    const start = (ring.next - ring.count + SCROLLBACK) % SCROLLBACK;
+    for (let i = 0; i < ring.count; i++) {
+      const slot = ring.slots[(start + i) % SCROLLBACK];
+      if (slot.seq <= since) continue;
+      const line = info.compressed && slot.deflated ? slot.deflated : encodeLine(info, slot.text, slot.seq);
+      if (info.compressed) countCompressed(info, slot.text, line.length);
+      lines.push(line);
     }
   }
+  if (lines.length === 0) {
+    writeTo(info.socket, reply);
+    return;
+  }
+  writeTo(info.socket, Buffer.concat([reply, encodeLine(info, `HISTORY ${lines.length}`), ...lines]));
 }
 
-// Start TCP chat server
-const tcpServer = net.createServer((socket) => {
-  socket.setEncoding('utf8');
+// Ends congestion once the socket has drained to the low watermark
+function recover(info) {
+  info.congested = false;
+  counters.congested--;
+  console.log(`Slow consumer ${info.username} caught up after ${info.skipped} withheld messages`);
+  if (SLOW_CLIENT_POLICY === 'coalesce') {
+    sendLine(info, `SERVER: ${info.skipped} messages were skipped because your connection fell behind`);
+  }
+  info.skipped = 0;
+}
+
+// Applies the slow-consumer policy; returns false if the broadcast must not
+// be written to this socket
+function admitBroadcast(info) {
+  const sock = info.socket;
+  if (sock.destroyed) return false;
+  if (info.congested) {
+    if (sock.writableLength > OUTPUT_LOW_WATER) {
+      withhold(info);
+      return false;
+    }
+    recover(info);
+  }
+  if (sock.writableLength < OUTPUT_HIGH_WATER) return true;
+
+  if (SLOW_CLIENT_POLICY === 'disconnect') {
+    console.log(`Disconnecting slow consumer ${info.username} (${sock.writableLength} bytes queued)`);
+    backpressure.disconnected++;
+    sock.destroy(); // 'close' (and the leave broadcast) follows asynchronously
+    return false;
+  }
+  console.log(`Slow consumer ${info.username} (${sock.writableLength} bytes queued): withholding broadcasts`);
+  info.congested = true;
+  counters.congested++;
+  withhold(info);
+  return false;
+}
+
+function withhold(info) {
+  info.skipped++;
+  if (SLOW_CLIENT_POLICY === 'coalesce') backpressure.coalesced++;
+  else backpressure.dropped++;
+}
+
+// Helper broadcast function: sends to every member of one room and
+// returns the broadcast's sequence number; chat messages (as opposed to
+// notices) are kept as scrollback. Both are logged, so a restart never
+// reissues a sequence number.
+// The message is encoded once per framing into a Buffer, and that same
+// Buffer is handed to every recipient: sockets keep a reference until the
+// bytes are written, so nothing is copied or re-encoded per recipient.
+function broadcast(senderSocket, room, message, chat = false) {
+  const seq = ++broadcastSeq;
+  if (messageLog) messageLog.append(seq, room, message, !chat);
+  const deflated = compressedSessions > 0 ? deflatedFrame(seq, message) : null;
+  if (chat) remember(room, seq, message, deflated);
+  const members = rooms.get(room);
+  if (!members) return seq;
+  const start = process.hrtime.bigint();
+  let line = null;
+  let frame = null;
+  let numbered = null;
+  for (const info of members) {
+    const sock = info.socket;
+    if (sock !== senderSocket && admitBroadcast(info)) {
+      if (info.compressed && deflated) {
+        countCompressed(info, message, deflated.length);
+        writeTo(sock, deflated);
+      } else if (info.binary) {
+        if (!frame) frame = encodeFrame(FRAME_TEXT, seq, message);
+        if (info.compressed) countCompressed(info, message, frame.length);
+        writeTo(sock, frame);
+      } else if (info.numbered) {
+        if (!numbered) numbered = encodeLine(info, message, seq);
+        writeTo(sock, numbered);
+      } else {
+        if (!line) line = Buffer.from(message + '\n', 'utf8');
+        writeTo(sock, line);
+      }
+    }
+  }
+  fanout.observe(Number(process.hrtime.bigint() - start));
+  return seq;
+}
+
+// One chat connection, over TCP or the Unix socket
+function handleConnection(socket) {
+  const decoder = new StringDecoder('utf8');
   let loggedIn = false;
   let username = null;
+  let binary = false;
+  let pending = Buffer.alloc(0); // Partial frame (binary clients only)
 
-  socket.write('WELCOME: send "LOGIN <username>" to join\n');
+  // Write callbacks carrying an error are for chunks that were discarded
+  sockets.set(socket, { queued: 0, flushed: (err) => err || account(socket) });
+  writeTo(socket, WELCOME);
 
-  socket.on('data', (data) => {
-    // data may contain multiple lines; handle line-by-line
-    const lines = data.split(/\r?\n/).filter(Boolean);
-    for (const line of lines) {
-      if (!loggedIn) {
-        const parts = line.trim().split(' ');
-        if (parts[0] === 'LOGIN' && parts[1]) {
-          username = parts.slice(1).join(' ');
-          loggedIn = true;
-          clients.set(socket, { username, socket });
-          console.log(`User logged in: ${username}`);
-          socket.write(`LOGIN_OK Welcome, ${username}\n`);
-          broadcast(socket, `SERVER: ${username} has joined the chat`);
-        } else {
-          socket.write('ERROR You must login first with: LOGIN <username>\n');
+  function handleLine(line) {
+    counters.messagesIn++;
+    if (!loggedIn) {
+      const parts = line.trim().split(' ');
+      if (parts[0] === 'LOGIN' && parts[1]) {
+        // Trailing capability tokens are not part of the username
+        let numbered = false;
+        let compressed = false;
+        let since = 0;
+        let room = DEFAULT_ROOM;
+        while (parts.length > 2) {
+          const token = parts[parts.length - 1];
+          let m;
+          if (token === BINARY_CAPABILITY) {
+            binary = true;
+          } else if (token === COMPRESSION_CAPABILITY) {
+            compressed = true;
+          } else if ((m = SEQUENCE_TOKEN.exec(token))) {
+            numbered = true;
+            since = Number(m[1]);
+          } else if ((m = ROOM_TOKEN.exec(token))) {
+            if (ROOM_NAME.test(m[1])) room = m[1];
+          } else {
+            break;
+          }
+          parts.pop();
+          while (parts.length > 2 && parts[parts.length - 1] === '') parts.pop();
         }
+        username = parts.slice(1).join(' ');
+        loggedIn = true;
+        counters.logins++;
+        compressed = compressed && binary; // Compressed payloads need frames
+        const compression = { frames: 0, plainBytes: 0, sentBytes: 0 };
+        const info = { username, socket, binary, numbered, compressed, compression, congested: false, skipped: 0, room: null };
+        clients.set(socket, info);
+        if (compressed) compressedSessions++;
+        indexUser(info);
+        enterRoom(info, room);
+        console.log(`User logged in: ${username}`);
+        // LOGIN_OK itself is always a text line; the scrollback after it is framed for binary clients
+        const caps = (binary ? BINARY_CAPABILITY + ' ' : '') +
+          (compressed ? COMPRESSION_CAPABILITY + ' ' : '') +
+          (numbered ? SEQUENCE_CAPABILITY + ' ' : '');
+        let reply = Buffer.from(`LOGIN_OK ${caps}Welcome, ${username}\n`);
+        if (room !== DEFAULT_ROOM) reply = Buffer.concat([reply, encodeLine(info, `JOIN_OK ${room}`)]);
+        // A sequence from before a restart without the message log means nothing here
+        sendWithScrollback(info, reply, since > broadcastSeq ? 0 : since);
+        broadcast(socket, room, `SERVER: ${username} has joined the chat`);
       } else {
-        const text = line.trim();
-        if (text.toLowerCase() === '/quit') {
-          socket.end('BYE\n');
+        writeTo(socket, LOGIN_REQUIRED);
+      }
+    } else {
+      const text = line.trim();
+      const info = clients.get(socket);
+      const space = text.indexOf(' ');
+      const command = (space === -1 ? text : text.slice(0, space)).toLowerCase();
+      const arg = space === -1 ? '' : text.slice(space + 1).trim();
+      if (text.toLowerCase() === '/quit') {
+        writeTo(socket, binary ? encodeFrame(FRAME_TEXT, 0, 'BYE') : Buffer.from('BYE\n'));
+        socket.end();
+      } else if (command === '/join') {
+        if (!ROOM_NAME.test(arg)) {
+          sendLine(info, `ERROR Room names are 1-${MAX_ROOM_NAME} letters, digits, '-' or '_'`);
+        } else {
+          switchRoom(info, arg);
+          sendWithScrollback(info, encodeLine(info, `JOIN_OK ${arg}`));
+        }
+      } else if (command === '/msg') {
+        whisper(info, arg);
+      } else if (command === '/part') {
+        if (info.room === DEFAULT_ROOM) {
+          sendLine(info, 'ERROR You are not in a room');
         } else {
-          const out = `${username}: ${text}`;
-          console.log('MSG ->', out);
-          broadcast(socket, out);
+          const left = info.room;
+          switchRoom(info, DEFAULT_ROOM);
+          sendLine(info, `PART_OK ${left}`);
         }
+      } else {
+        const out = `${username}: ${text}`;
+        broadcast(socket, info.room, out, true);
       }
     }
+  }
+
+  function handleFrames(chunk) {
+    pending = pending.length ? Buffer.concat([pending, chunk]) : chunk;
+    while (pending.length >= FRAME_HEADER_SIZE) {
+      const length = pending.readUInt32BE(0);
+      if (length > MAX_FRAME_PAYLOAD) {
+        console.log(`Oversized frame from ${username}, disconnecting`);
+        socket.destroy();
+        return;
+      }
+      if (pending.length < FRAME_HEADER_SIZE + length) break;
+      const type = pending[4];
+      const payload = pending.toString('utf8', FRAME_HEADER_SIZE, FRAME_HEADER_SIZE + length);
+      pending = pending.subarray(FRAME_HEADER_SIZE + length);
+      if (type === FRAME_TEXT && payload) handleLine(payload);
+    }
+  }
+
+  socket.on('data', (chunk) => {
+    counters.bytesIn += chunk.length;
+    if (binary) {
+      handleFrames(chunk);
+      return;
+    }
+    // Until LOGIN succeeds, take lines straight from the raw bytes so that a
+    // "+bin" login can hand the rest of the chunk to the frame decoder.
+    let offset = 0;
+    while (!loggedIn && offset < chunk.length) {
+      let nl = chunk.indexOf(10, offset);
+      if (nl === -1) nl = chunk.length;
+      const line = chunk.toString('utf8', offset, nl).replace(/\r$/, '');
+      offset = nl + 1;
+      if (line) handleLine(line);
+    }
+    if (offset >= chunk.length) return;
+    if (binary) {
+      handleFrames(chunk.subarray(offset));
+      return;
+    }
+    // data may contain multiple lines; handle line-by-line
+    const data = decoder.write(offset ? chunk.subarray(offset) : chunk);
+    const lines = data.split(/\r?\n/).filter(Boolean);
+    for (const line of lines) handleLine(line);
+  });
+
+  // Write buffer empty: a congested client may receive broadcasts again
+  socket.on('drain', () => {
+    account(socket);
+    const info = clients.get(socket);
+    if (info && info.congested) recover(info);
   });
 
   socket.on('close', () => {
+    // Whatever was still queued will never be written: it leaves the queue
+    // total without counting as sent
+    counters.queuedBytes -= sockets.get(socket).queued;
+    sockets.delete(socket);
     if (loggedIn) {
+      const info = clients.get(socket);
+      if (info.congested) counters.congested--;
       clients.delete(socket);
+      unindexUser(info);
+      leaveRoom(info);
       console.log(`User disconnected: ${username}`);
-      broadcast(socket, `SERVER: ${username} has left the chat`);
+      if (info.compressed) {
+        compressedSessions--;
+        console.log(`Compression for ${username}: ${describeCompression(info.compression)}`);
+      }
+      broadcast(socket, info.room, `SERVER: ${username} has left the chat`);
     }
   });
 
   socket.on('error', (err) => {
     console.log('Socket error', err.message);
   });
-});
+}
 
+// Start TCP chat server
+const tcpServer = net.createServer(handleConnection);
 tcpServer.listen(TCP_PORT, () => {
   console.log(`TCP chat server listening on port ${TCP_PORT}`);
 });
 
-// Simple express HTTP endpoint to list connected users
+// Same-host clients can skip the TCP loopback stack: UNIX_SOCKET=<path>
+// also accepts chat connections there, with the same protocol (see
+// unix_socket.hpp). Abstract names ("@name") are native-server only: libuv
+// binds them padded to the full sun_path, so clients could not reach them.
+if (UNIX_SOCKET.startsWith('@')) {
+  console.error(`UNIX_SOCKET=${UNIX_SOCKET}: abstract socket names need the native server; use a path`);
+  process.exit(1);
+}
+if (UNIX_SOCKET) {
+  try {
+    if (fs.lstatSync(UNIX_SOCKET).isSocket()) fs.unlinkSync(UNIX_SOCKET); // Left by an earlier run
+  } catch (err) {
+    // No such file: nothing to replace
+  }
+  net.createServer(handleConnection).listen(UNIX_SOCKET, () => {
+    console.log(`Unix chat socket at ${UNIX_SOCKET}`);
+  });
+}
+
+// Connected users, sorted by name: ?room= lists one room, ?prefix= filters
+// by name, ?limit= and ?after= page through them (see user_directory.js).
+// Served from the directory's snapshot; unchanged lists answer 304.
 app.get('/users', (req, res) => {
-  const users = [];
-  for (const [, info] of clients.entries()) {
-    users.push(info.username);
+  const etag = directory.etag;
+  res.set('ETag', etag);
+  if (matchesEtag(req.get('If-None-Match'), etag)) {
+    res.status(304).end();
+    return;
   }
-  res.json({ users });
+  res.type('application/json').send(directory.page(parseQuery(req.query)));
+});
+
+// Prometheus scrape target (format shared with the native server's --metrics-port)
+app.get('/metrics', (req, res) => {
+  const text = renderMetrics({
+    chat_connections: sockets.size,
+    chat_sessions: clients.size,
+    chat_logins_total: counters.logins,
+    chat_messages_received_total: counters.messagesIn,
+    chat_messages_sent_total: counters.messagesOut,
+    chat_bytes_received_total: counters.bytesIn,
+    chat_bytes_sent_total: counters.bytesOut,
+    chat_output_queue_bytes: counters.queuedBytes,
+    chat_congested_clients: counters.congested,
+    chat_messages_dropped_total: backpressure.dropped + backpressure.coalesced,
+    chat_slow_consumer_disconnects_total: backpressure.disconnected,
+    chat_compression_plain_bytes_total: counters.compressedPlainBytes,
+    chat_compression_sent_bytes_total: counters.compressedSentBytes,
+  }, fanout);
+  res.type('text/plain; version=0.0.4; charset=utf-8').send(text);
 });
 
 app.get('/', (req, res) => {
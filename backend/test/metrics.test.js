@@ -0,0 +1,109 @@
+// metrics.test.js
+// /metrics counters of server.js, checked against a real server process.
+// Run with `npm test` in backend/ (needs `npm install` for express).
+const test = require('node:test');
+const assert = require('node:assert');
+const net = require('net');
+const path = require('path');
+const { spawn } = require('child_process');
+
+const BACKEND = path.join(__dirname, '..');
+let haveExpress = true;
+try {
+  require.resolve('express', { paths: [BACKEND] });
+} catch (err) {
+  haveExpress = false;
+}
+
+// Starts server.js on free-ish ports and resolves once both listeners are up
+function startServer(env) {
+  const tcpPort = 20000 + Math.floor(Math.random() * 20000);
+  const server = spawn(process.execPath, [path.join(BACKEND, 'server.js')], {
+    env: { ...process.env, TCP_PORT: tcpPort, HTTP_PORT: tcpPort + 1, MESSAGE_LOG_DIR: 'off', ...env },
+    stdio: ['ignore', 'pipe', 'inherit'],
+  });
+  server.output = '';
+  return new Promise((resolve, reject) => {
+    server.stdout.on('data', (chunk) => {
+      server.output += chunk;
+      if (/TCP chat server listening/.test(server.output) && /HTTP server listening/.test(server.output)) {
+        resolve({ server, tcpPort, httpPort: tcpPort + 1 });
+      }
+    });
+    server.on('exit', (code) => reject(new Error(`server.js exited with ${code}`)));
+  });
+}
+
+function waitFor(predicate, timeoutMs = 20000) {
+  const start = Date.now();
+  return new Promise((resolve, reject) => {
+    const poll = () => {
+      if (predicate()) resolve();
+      else if (Date.now() - start > timeoutMs) reject(new Error('timed out'));
+      else setTimeout(poll, 20);
+    };
+    poll();
+  });
+}
+
+async function scrape(port) {
+  const res = await fetch(`http://127.0.0.1:${port}/metrics`);
+  const metrics = {};
+  for (const line of (await res.text()).split('\n')) {
+    const m = /^(\w+) (\d+(?:\.\d+)?)$/.exec(line);
+    if (m) metrics[m[1]] = Number(m[2]);
+  }
+  return metrics;
+}
+
+// Logs in and counts every byte received
+function login(port, name) {
+  const socket = net.connect(port, '127.0.0.1');
+  socket.received = 0;
+  socket.on('data', (chunk) => {
+    socket.received += chunk.length;
+  });
+  socket.write(`LOGIN ${name}\n`);
+  return socket;
+}
+
+test('a destroyed slow consumer does not count its dropped queue as sent', { skip: !haveExpress }, async () => {
+  const HIGH_WATER = 2 * 1024 * 1024;
+  const { server, tcpPort, httpPort } = await startServer({
+    SLOW_CLIENT_POLICY: 'disconnect',
+    OUTPUT_HIGH_WATER: HIGH_WATER,
+  });
+  try {
+    const slow = login(tcpPort, 'slow');
+    await waitFor(() => slow.received > 0 && /User logged in: slow/.test(server.output));
+    slow.pause(); // Stops reading: the server's queue for it grows
+    const talker = login(tcpPort, 'talker');
+    await waitFor(() => /User logged in: talker/.test(server.output));
+
+    // Talk until the server gives up on the slow reader
+    const line = Buffer.from('x'.repeat(1000) + '\n');
+    const disconnected = () => /Disconnecting slow consumer slow/.test(server.output);
+    while (!disconnected()) {
+      if (!talker.write(line)) await new Promise((resolve) => talker.once('drain', resolve));
+    }
+
+    // Everything that really left the server reaches the slow reader before EOF
+    const closed = new Promise((resolve) => slow.on('close', resolve));
+    slow.resume();
+    await closed;
+    await waitFor(() => /User disconnected: slow/.test(server.output));
+    await new Promise((resolve) => setTimeout(resolve, 200));
+
+    const metrics = await scrape(httpPort);
+    const delivered = slow.received + talker.received;
+    assert.strictEqual(metrics.chat_output_queue_bytes, 0);
+    assert.strictEqual(metrics.chat_congested_clients, 0);
+    // The dropped queue was at least HIGH_WATER bytes; allow a little for
+    // anything still on its way to the talker
+    assert.ok(metrics.chat_bytes_sent_total <= delivered + 4096,
+      `${metrics.chat_bytes_sent_total} bytes reported sent, ${delivered} delivered`);
+    talker.destroy();
+  } finally {
+    server.kill();
+  }
+});
@@ -0,0 +1,118 @@
+// user_directory.test.js
+// Pagination, cursors and ETags of the GET /users directory.
+const test = require('node:test');
+const assert = require('node:assert');
+const { UserDirectory, parseQuery, matchesEtag } = require('../user_directory');
+
+const query = (q = {}) => ({ room: '', prefix: '', after: '', limit: 1000, ...q });
+const page = (dir, q) => JSON.parse(dir.page(query(q)));
+
+// Follows "next" from the first page and returns every page's users
+function allPages(dir, q) {
+  const pages = [];
+  let after = '';
+  for (;;) {
+    const { users, next } = page(dir, { ...q, after });
+    pages.push(users);
+    if (next === undefined) return pages;
+    after = next;
+  }
+}
+
+test('pages are sorted and never split the sessions of a name', () => {
+  const dir = new UserDirectory();
+  for (const name of ['carol', 'alice', 'bob', 'alice', 'dave', 'bob', 'alice']) dir.add(name);
+  assert.deepStrictEqual(page(dir, {}), {
+    users: ['alice', 'alice', 'alice', 'bob', 'bob', 'carol', 'dave'],
+  });
+  assert.deepStrictEqual(allPages(dir, { limit: 1 }), [
+    ['alice', 'alice', 'alice'], ['bob', 'bob'], ['carol'], ['dave'],
+  ]);
+  assert.deepStrictEqual(allPages(dir, { limit: 3 }), [
+    ['alice', 'alice', 'alice', 'bob', 'bob', 'carol'], ['dave'],
+  ]);
+  assert.deepStrictEqual(page(dir, { limit: 2 }).next, 'bob');
+});
+
+test('prefix and room filters', () => {
+  const dir = new UserDirectory();
+  for (const name of ['ann', 'anna', 'bob', 'andy', 'anna']) dir.add(name);
+  dir.enterRoom('anna', 'dev');
+  dir.enterRoom('bob', 'dev');
+  dir.enterRoom('ann', 'ops');
+  assert.deepStrictEqual(page(dir, { prefix: 'ann' }).users, ['ann', 'anna', 'anna']);
+  assert.deepStrictEqual(allPages(dir, { prefix: 'an', limit: 2 }), [['andy', 'ann'], ['anna', 'anna']]);
+  assert.deepStrictEqual(page(dir, { prefix: 'z' }).users, []);
+  assert.deepStrictEqual(page(dir, { room: 'dev' }).users, ['anna', 'bob']);
+  assert.deepStrictEqual(page(dir, { room: 'dev', prefix: 'b' }).users, ['bob']);
+  assert.deepStrictEqual(page(dir, { room: 'nowhere' }).users, []);
+  // An ?after= before the prefix starts at the prefix
+  assert.deepStrictEqual(page(dir, { prefix: 'b', after: 'a' }).users, ['bob']);
+
+  dir.leaveRoom('bob', 'dev');
+  dir.leaveRoom('anna', 'dev');
+  assert.deepStrictEqual(page(dir, { room: 'dev' }).users, []);
+  assert.ok(!dir.rooms.has('dev'));
+});
+
+test('the cursor stays valid when its name logs out', () => {
+  const dir = new UserDirectory();
+  for (const name of ['a', 'b', 'c', 'd', 'e', 'f']) dir.add(name);
+  const first = page(dir, { limit: 2 });
+  assert.deepStrictEqual(first, { users: ['a', 'b'], next: 'b' });
+  // The cursor name and the next one leave, someone joins before the cursor
+  dir.remove('b');
+  dir.remove('c');
+  dir.add('aa');
+  assert.deepStrictEqual(page(dir, { limit: 2, after: first.next }), { users: ['d', 'e'], next: 'e' });
+  dir.remove('f');
+  assert.deepStrictEqual(page(dir, { limit: 2, after: 'e' }), { users: [] });
+  // Removing a name that is not logged in changes nothing
+  const { version } = dir;
+  dir.remove('nobody');
+  dir.leaveRoom('nobody', 'dev');
+  assert.strictEqual(dir.version, version);
+});
+
+test('the ETag changes with every change and cached pages follow it', () => {
+  const dir = new UserDirectory();
+  dir.add('alice');
+  const etag = dir.etag;
+  const body = dir.page(query());
+  assert.strictEqual(dir.page(query()), body);
+  assert.strictEqual(dir.etag, etag);
+
+  dir.add('bob');
+  assert.notStrictEqual(dir.etag, etag);
+  assert.deepStrictEqual(JSON.parse(dir.page(query())).users, ['alice', 'bob']);
+  const afterAdd = dir.etag;
+  dir.enterRoom('bob', 'dev');
+  assert.notStrictEqual(dir.etag, afterAdd);
+  const afterJoin = dir.etag;
+  dir.remove('alice');
+  assert.notStrictEqual(dir.etag, afterJoin);
+  assert.deepStrictEqual(JSON.parse(dir.page(query())).users, ['bob']);
+});
+
+test('matchesEtag', () => {
+  const etag = '"k9x-3"';
+  assert.ok(matchesEtag(etag, etag));
+  assert.ok(matchesEtag(`W/${etag}`, etag));
+  assert.ok(matchesEtag(`"other", ${etag}`, etag));
+  assert.ok(matchesEtag('*', etag));
+  assert.ok(!matchesEtag('"k9x-2"', etag));
+  assert.ok(!matchesEtag(undefined, etag));
+  assert.ok(!matchesEtag('', etag));
+});
+
+test('parseQuery', () => {
+  assert.deepStrictEqual(parseQuery({}), { room: '', prefix: '', after: '', limit: 1000 });
+  assert.deepStrictEqual(parseQuery({ room: 'dev', prefix: 'a', after: 'al', limit: '50' }), {
+    room: 'dev', prefix: 'a', after: 'al', limit: 50,
+  });
+  assert.strictEqual(parseQuery({ limit: '999999' }).limit, 10000);
+  assert.strictEqual(parseQuery({ limit: '0' }).limit, 1000);
+  assert.strictEqual(parseQuery({ limit: 'abc' }).limit, 1000);
+  // Repeated parameters arrive as arrays and are ignored
+  assert.strictEqual(parseQuery({ room: ['a', 'b'] }).room, '');
+});
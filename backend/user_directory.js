@@ -0,0 +1,169 @@
+// user_directory.js
+// Versioned snapshot of who is logged in, for GET /users.
+//
+// The chat server reports logins, logouts and room changes as they happen;
+// the directory counts the sessions per name (all users, and per room) in
+// O(1) and bumps its version, so the chat loop never pays for sorting. The
+// first request after a change sorts the changed list once; requests never
+// walk the live client map: they binary-search the sorted names and
+// serialize one page, and that JSON is cached until the version changes.
+// The version also serves as the ETag, so a dashboard polling an unchanged
+// list gets "304 Not Modified" without any work at all.
+//
+// Names are not unique (see user_index.hpp): a name logged in twice appears
+// twice. Pages are cut by name (keyset pagination with ?after=<last name>),
+// so all sessions of a name always land on the same page and pages stay
+// consistent while users come and go.
+
+const DEFAULT_PAGE = 1000; // Names per page when ?limit= is absent
+const MAX_PAGE = 10000;
+const MAX_CACHED_PAGES = 256;
+
+// First index in sorted whose name is >= name (or > name if after)
+function search(sorted, name, after = false) {
+  let lo = 0;
+  let hi = sorted.length;
+  while (lo < hi) {
+    const mid = (lo + hi) >>> 1;
+    if (sorted[mid] < name || (after && sorted[mid] === name)) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// Logged-in names with their session counts, sorted only when read
+class NameSet {
+  constructor() {
+    this.counts = new Map(); // name -> sessions
+    this.size = 0;
+    this.snapshot = [];      // Sorted names, one entry per session; null when stale
+  }
+
+  add(name) {
+    this.counts.set(name, (this.counts.get(name) || 0) + 1);
+    this.size++;
+    this.snapshot = null;
+  }
+
+  // Returns false if name has no session here
+  delete(name) {
+    const count = this.counts.get(name);
+    if (!count) return false;
+    if (count === 1) this.counts.delete(name);
+    else this.counts.set(name, count - 1);
+    this.size--;
+    this.snapshot = null;
+    return true;
+  }
+
+  sorted() {
+    if (!this.snapshot) {
+      this.snapshot = [];
+      for (const name of [...this.counts.keys()].sort()) {
+        for (let n = this.counts.get(name); n > 0; n--) this.snapshot.push(name);
+      }
+    }
+    return this.snapshot;
+  }
+}
+
+class UserDirectory {
+  constructor() {
+    this.all = new NameSet(); // Every logged-in session's name
+    this.rooms = new Map();   // room -> NameSet of its members
+    this.version = 0;
+    // Distinguishes versions from before a restart
+    this.epoch = Date.now().toString(36);
+    this.pages = new Map(); // query -> serialized page, for this.version only
+    this.pagesVersion = 0;
+  }
+
+  get etag() {
+    return `"${this.epoch}-${this.version}"`;
+  }
+
+  add(name) {
+    this.insert(this.all, name);
+  }
+
+  remove(name) {
+    this.delete(this.all, name);
+  }
+
+  enterRoom(name, room) {
+    let members = this.rooms.get(room);
+    if (!members) this.rooms.set(room, (members = new NameSet()));
+    this.insert(members, name);
+  }
+
+  leaveRoom(name, room) {
+    const members = this.rooms.get(room);
+    if (!members) return;
+    this.delete(members, name);
+    if (members.size === 0) this.rooms.delete(room);
+  }
+
+  // One page as JSON: { users, next } ("next" is the ?after= of the
+  // following page, absent on the last one). query: { room, prefix, after, limit }
+  page(query) {
+    if (this.pagesVersion !== this.version || this.pages.size >= MAX_CACHED_PAGES) {
+      this.pages.clear();
+      this.pagesVersion = this.version;
+    }
+    const key = `${query.room}\0${query.prefix}\0${query.after}\0${query.limit}`;
+    let body = this.pages.get(key);
+    if (body === undefined) {
+      body = JSON.stringify(this.collect(query));
+      this.pages.set(key, body);
+    }
+    return body;
+  }
+
+  collect({ room, prefix, after, limit }) {
+    const members = room ? this.rooms.get(room) : this.all;
+    const sorted = members ? members.sorted() : [];
+    let i = after && after >= prefix ? search(sorted, after, true) : search(sorted, prefix);
+    const users = [];
+    let names = 0;
+    while (i < sorted.length && sorted[i].startsWith(prefix)) {
+      const name = sorted[i];
+      if (names === limit) return { users, next: users[users.length - 1] };
+      names++;
+      // Every session of this name, so the cursor never splits them
+      while (i < sorted.length && sorted[i] === name) users.push(sorted[i++]);
+    }
+    return { users };
+  }
+
+  insert(set, name) {
+    set.add(name);
+    this.version++;
+  }
+
+  delete(set, name) {
+    if (set.delete(name)) this.version++;
+  }
+}
+
+// Reads ?room=&prefix=&after=&limit= from an Express query object
+function parseQuery(q) {
+  const text = (v) => (typeof v === 'string' ? v : '');
+  const limit = parseInt(q.limit, 10);
+  return {
+    room: text(q.room),
+    prefix: text(q.prefix),
+    after: text(q.after),
+    limit: limit > 0 ? Math.min(limit, MAX_PAGE) : DEFAULT_PAGE,
+  };
+}
+
+// Whether an If-None-Match header matches etag ("*", lists and W/ included)
+function matchesEtag(header, etag) {
+  if (!header) return false;
+  return header.split(',').some((tag) => {
+    const t = tag.trim();
+    return t === '*' || t === etag || t === `W/${etag}`;
+  });
+}
+
+module.exports = { UserDirectory, parseQuery, matchesEtag };
@@ -0,0 +1,176 @@
+/**
+ * @file binary_frame.hpp
+ * @brief Optional length-prefixed binary framing, negotiated at LOGIN.
+ *
+ * A client that appends the capability token "+bin" to its LOGIN line
+ * ("LOGIN alice +bin") gets "LOGIN_OK +bin Welcome, alice" back if the server
+ * supports frames; an older server replies "LOGIN_OK Welcome, alice +bin" and
+ * the connection simply stays in text mode. From the byte after the accepting
+ * reply's "\n" on, both directions carry frames instead of text lines:
+ *
+ *     offset  size  field
+ *     0       4     payload length (big-endian, at most MAX_FRAME_PAYLOAD)
+ *     4       1     type (FrameType)
+ *     5       1     flags (FrameFlags)
+ *     6       2     reserved (0)
+ *     8       8     sequence number (big-endian)
+ *     16      n     payload
+ *
+ * A TEXT frame carries exactly what would otherwise be one text line (for
+ * example "alice: hi" or "SERVER: bob has joined the chat"), but the payload
+ * may contain "\n". Client frames number the client's own messages; server
+ * frames carry the server-wide broadcast sequence (0 for direct replies).
+ * Finding a frame boundary takes O(1) work instead of scanning every byte.
+ *
+ * A client that also sends "+z" may get server frames with FRAME_FLAG_DEFLATE
+ * set; see message_compression.hpp.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr size_t FRAME_HEADER_SIZE = 16;
+constexpr uint32_t MAX_FRAME_PAYLOAD = 1 << 20;
+// LOGIN capability token (echoed right after LOGIN_OK when accepted)
+constexpr std::string_view BINARY_CAPABILITY = "+bin";
+// LOGIN capability token for compressed frames; only accepted with "+bin"
+constexpr std::string_view COMPRESSION_CAPABILITY = "+z";
+
+enum FrameType : uint8_t {
+    FRAME_TEXT = 1  // One chat line (message, notice or command)
+};
+
+enum FrameFlags : uint8_t {
+    FRAME_FLAG_DEFLATE = 0x01  // Payload is deflated (server -> "+z" client only)
+};
+
+struct FrameHeader {
+    uint32_t length = 0;
+    uint8_t type = FRAME_TEXT;
+    uint8_t flags = 0;
+    uint64_t sequence = 0;
+};
+
+/**
+ * @brief Writes a header into out[0..FRAME_HEADER_SIZE).
+ */
+inline void encodeFrameHeader(char *out, const FrameHeader &h) {
+    for (int i = 0; i < 4; ++i) out[i] = (char)(h.length >> (24 - 8 * i));
+    out[4] = (char)h.type;
+    out[5] = (char)h.flags;
+    out[6] = out[7] = 0;
+    for (int i = 0; i < 8; ++i) out[8 + i] = (char)(h.sequence >> (56 - 8 * i));
+}
+
+inline FrameHeader decodeFrameHeader(const char *in) {
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(in);
+    FrameHeader h;
+    h.length = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    h.type = p[4];
+    h.flags = p[5];
+    h.sequence = 0;
+    for (int i = 0; i < 8; ++i) h.sequence = h.sequence << 8 | p[8 + i];
+    return h;
+}
+
+/**
+ * @brief Appends one complete frame (header + payload) to out.
+ */
+inline void appendFrame(std::string &out, uint8_t type, uint64_t sequence,
+                        std::string_view payload, uint8_t flags = 0) {
+    FrameHeader h;
+    h.length = (uint32_t)payload.size();
+    h.type = type;
+    h.flags = flags;
+    h.sequence = sequence;
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, h);
+    out.append(header, FRAME_HEADER_SIZE);
+    out.append(payload.data(), payload.size());
+}
+
+/**
+ * @brief Whether a LOGIN reply is "LOGIN_OK +bin ...", i.e. frames follow.
+ */
+inline bool acceptsBinaryFrames(std::string_view reply) {
+    constexpr std::string_view ok = "LOGIN_OK ";
+    if (reply.substr(0, ok.size()) != ok) return false;
+    reply.remove_prefix(ok.size());
+    return reply.size() > BINARY_CAPABILITY.size() &&
+           reply.substr(0, BINARY_CAPABILITY.size()) == BINARY_CAPABILITY &&
+           reply[BINARY_CAPABILITY.size()] == ' ';
+}
+
+/**
+ * @brief Reassembles frames from a byte stream.
+ * Same buffer strategy as LineFramer: receive straight into writePtr(),
+ * hand out payloads as views, slide leftovers to the front when needed.
+ */
+class FrameDecoder {
+public:
+    enum class Result { Frame, NeedMore, Error };
+
+    explicit FrameDecoder(size_t initialCapacity = 4096)
+        : buf(initialCapacity ? initialCapacity : FRAME_HEADER_SIZE) {}
+
+    /**
+     * @brief Where the next recv() should write. Call before writable().
+     * Payloads returned by next() are invalidated by this call.
+     */
+    char *writePtr(size_t minFree = 4096) {
+        if (buf.size() - tail < minFree) makeRoom(minFree);
+        return buf.data() + tail;
+    }
+
+    size_t writable() const { return buf.size() - tail; }
+    void commit(size_t n) { tail += n; }
+
+    void append(const char *data, size_t n) {
+        std::memcpy(writePtr(n), data, n);
+        commit(n);
+    }
+
+    /**
+     * @brief Extracts the next complete frame.
+     * @return Error if the header announces an oversized payload.
+     */
+    Result next(FrameHeader &header, std::string_view &payload) {
+        if (tail - head < FRAME_HEADER_SIZE) return Result::NeedMore;
+        header = decodeFrameHeader(buf.data() + head);
+        if (header.length > MAX_FRAME_PAYLOAD) return Result::Error;
+        if (tail - head < FRAME_HEADER_SIZE + header.length) return Result::NeedMore;
+
+        payload = std::string_view(buf.data() + head + FRAME_HEADER_SIZE, header.length);
+        head += FRAME_HEADER_SIZE + header.length;
+        if (head == tail) head = tail = 0; // Cheap reset when fully consumed
+        return Result::Frame;
+    }
+
+    size_t buffered() const { return tail - head; }
+    void clear() { head = tail = 0; }
+
+private:
+    std::vector<char> buf;
+    size_t head = 0;
+    size_t tail = 0;
+
+    void makeRoom(size_t minFree) {
+        size_t live = tail - head;
+        if (head > 0) {
+            std::memmove(buf.data(), buf.data() + head, live);
+            tail = live;
+            head = 0;
+        }
+        size_t need = live + minFree;
+        if (buf.size() < need) {
+            size_t cap = buf.size();
+            while (cap < need) cap *= 2;
+            buf.resize(cap);
+        }
+    }
+};
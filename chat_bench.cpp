@@ -0,0 +1,520 @@
+/**
+ * @file chat_bench.cpp
+ * @brief End-to-end loopback benchmark: starts a chat server, drives it with
+ * chat_loadgen and reports throughput, latency, CPU and memory per scenario.
+ *
+ * A scenario is a file of chat_loadgen options, one per line ("#" starts a
+ * comment); the checked-in ones live in bench/ so that results stay
+ * comparable from commit to commit:
+ * 1. steady_chat: many sessions chatting at a constant rate.
+ * 2. join_storm: thousands of sessions logging in at once.
+ * 3. hot_talker: one session sending fast to a full room.
+ * 4. idle_users: a large room where only a few sessions talk.
+ *
+ * For every scenario a fresh server (the native chatserver, or
+ * backend/server.js under node) is started on a free loopback port, and
+ * chat_loadgen runs against it with --json. Meanwhile the driver samples
+ * the server's CPU time and memory from /proc; the load generator's come
+ * from wait4(). Results are printed as a table; --json FILE also writes
+ * them, with the commit they were measured at. With --unix the load
+ * generator connects over the server's Unix domain socket instead of TCP.
+ */
+
+#include <iostream>
+#include <iomanip>     // For the table columns
+#include <fstream>     // For scenario files and --json
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>         // For the load generator's JSON fields
+#include <algorithm>   // For std::sort (scenario order)
+#include <chrono>
+#include <thread>      // For sleeping between /proc samples
+#include <ctime>       // For the date in the JSON context
+#include <cstring>     // For strerror()
+#include <cerrno>
+#include <csignal>
+#include <cstdio>      // For popen() (git rev-parse)
+#include <cstdlib>     // For setenv()
+#include <unistd.h>
+#include <fcntl.h>     // For O_CLOEXEC / O_WRONLY
+#include <dirent.h>    // For listing bench/
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h> // For wait4() usage and RLIMIT_NOFILE
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "chat_connection.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// How often the server's CPU time and memory are sampled
+constexpr int SAMPLE_MS = 100;
+// How long a server may take to accept connections, or to exit on SIGTERM
+constexpr int STARTUP_TIMEOUT_MS = 10000;
+constexpr int SHUTDOWN_TIMEOUT_MS = 5000;
+
+struct BenchConfig {
+    std::string server = "native";      // "native" or "node"
+    std::string serverCmd;              // Default: ./chatserver, or node
+    std::vector<std::string> serverArgs;
+    std::string loadgen = "./chat_loadgen";
+    std::string jsonPath;
+    bool unixSocket = false;            // Connect over a Unix socket instead of TCP
+    std::vector<std::string> scenarios; // Default: bench/*.scenario
+};
+
+/**
+ * @brief One scenario's measurements.
+ */
+struct ScenarioResult {
+    std::string name;
+    bool ok = false;
+    std::string error;
+    double wallSeconds = 0;
+    std::map<std::string, double> loadgen; // chat_loadgen --json fields
+    double serverCpuSeconds = 0;
+    long serverRssKb = 0;                  // Peak resident set
+    double loadgenCpuSeconds = 0;
+    long loadgenRssKb = 0;
+
+    double field(const std::string &key) const {
+        auto it = loadgen.find(key);
+        return it == loadgen.end() ? 0 : it->second;
+    }
+};
+
+/**
+ * @brief Reads a scenario file into chat_loadgen arguments.
+ */
+bool readScenario(const std::string &path, std::vector<std::string> &args) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string word;
+        while (words >> word) args.push_back(word);
+    }
+    return true;
+}
+
+/**
+ * @brief "bench/hot_talker.scenario" -> "hot_talker".
+ */
+std::string scenarioName(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind(".scenario");
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+std::vector<std::string> defaultScenarios() {
+    std::vector<std::string> paths;
+    if (DIR *dir = opendir("bench")) {
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 9 && name.compare(name.size() - 9, 9, ".scenario") == 0) {
+                paths.push_back("bench/" + name);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+/**
+ * @brief A loopback port nobody listens on right now (bind to port 0).
+ * @return The port, or 0 on failure.
+ */
+int freePort() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return 0;
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int port = 0;
+    if (makeServerAddress(DEFAULT_SERVER_HOST, 0, addr) &&
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+/**
+ * @brief fork() + execvp() of args[0], with stdout sent to outFd, or to
+ * /dev/null if outFd is -1 (stderr stays on the terminal).
+ * @return The child's pid, or -1.
+ */
+pid_t spawn(const std::vector<std::string> &args, int outFd) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(outFd >= 0 ? outFd : devNull, STDOUT_FILENO);
+    std::vector<char*> argv;
+    for (const std::string &arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    execvp(argv[0], argv.data());
+    std::cerr << "Cannot run " << args[0] << ": " << strerror(errno) << std::endl;
+    _exit(127);
+}
+
+/**
+ * @brief Waits until something accepts connections on the port.
+ * @return false if the server exited or did not come up in time.
+ */
+bool waitForServer(pid_t pid, int port) {
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(STARTUP_TIMEOUT_MS);
+    while (Clock::now() < deadline) {
+        if (waitpid(pid, nullptr, WNOHANG) == pid) return false;
+        int fd = connectToServer(DEFAULT_SERVER_HOST, port);
+        if (fd >= 0) {
+            close(fd);
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+/**
+ * @brief User + system CPU seconds of a running process (/proc/<pid>/stat).
+ */
+double processCpuSeconds(pid_t pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    std::getline(in, stat);
+    // The command name may contain spaces; the fields after it do not
+    size_t paren = stat.rfind(')');
+    if (paren == std::string::npos) return 0;
+    std::istringstream fields(stat.substr(paren + 2));
+    std::string field;
+    unsigned long long utime = 0, stime = 0;
+    // Fields 3-13 come first; utime and stime are 14 and 15
+    for (int i = 3; i <= 13 && fields >> field; ++i) {}
+    fields >> utime >> stime;
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/**
+ * @brief Peak resident set of a running process in KiB (VmHWM), or 0.
+ */
+long processPeakRssKb(pid_t pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::atol(line.c_str() + 6);
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses the flat {"key":number,...} object printed by chat_loadgen --json.
+ */
+std::map<std::string, double> parseFlatJson(const std::string &text) {
+    std::map<std::string, double> fields;
+    size_t pos = 0;
+    while ((pos = text.find('"', pos)) != std::string::npos) {
+        size_t end = text.find('"', pos + 1);
+        if (end == std::string::npos || end + 1 >= text.size() || text[end + 1] != ':') break;
+        std::string key = text.substr(pos + 1, end - pos - 1);
+        fields[key] = std::strtod(text.c_str() + end + 2, nullptr);
+        pos = text.find_first_of(",}", end);
+    }
+    return fields;
+}
+
+/**
+ * @brief SIGTERM, then SIGKILL if the process has not exited in time.
+ */
+void stopProcess(pid_t pid) {
+    kill(pid, SIGTERM);
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(SHUTDOWN_TIMEOUT_MS);
+    while (Clock::now() < deadline) {
+        if (waitpid(pid, nullptr, WNOHANG) == pid) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+/**
+ * @brief Starts a server, runs one scenario against it and stops it.
+ */
+ScenarioResult runScenario(const BenchConfig &cfg, const std::string &path) {
+    ScenarioResult result;
+    result.name = scenarioName(path);
+
+    std::vector<std::string> loadArgs = {cfg.loadgen};
+    if (!readScenario(path, loadArgs)) {
+        result.error = "cannot read " + path;
+        return result;
+    }
+    int port = freePort();
+    if (port == 0) {
+        result.error = "no free port";
+        return result;
+    }
+    loadArgs.insert(loadArgs.end(), {"--port", std::to_string(port), "--json"});
+    // The TCP port stays up as well; waitForServer() polls it
+    std::string unixPath;
+    if (cfg.unixSocket) {
+        unixPath = "/tmp/chat_bench-" + std::to_string(getpid()) + ".sock";
+        loadArgs.insert(loadArgs.end(), {"--unix", unixPath});
+    }
+
+    // The node server takes its ports from the environment and must not
+    // leave a message log behind
+    std::vector<std::string> serverArgs;
+    if (cfg.server == "node") {
+        setenv("TCP_PORT", std::to_string(port).c_str(), 1);
+        setenv("HTTP_PORT", std::to_string(freePort()).c_str(), 1);
+        setenv("MESSAGE_LOG_DIR", "off", 1);
+        setenv("UNIX_SOCKET", unixPath.c_str(), 1);
+        serverArgs = {cfg.serverCmd.empty() ? "node" : cfg.serverCmd, "backend/server.js"};
+    } else {
+        serverArgs = {cfg.serverCmd.empty() ? "./chatserver" : cfg.serverCmd, "--port", std::to_string(port)};
+        if (cfg.unixSocket) serverArgs.insert(serverArgs.end(), {"--unix", unixPath});
+    }
+    serverArgs.insert(serverArgs.end(), cfg.serverArgs.begin(), cfg.serverArgs.end());
+
+    pid_t server = spawn(serverArgs, -1);
+    if (server < 0 || !waitForServer(server, port)) {
+        result.error = "server did not start";
+        if (server > 0) stopProcess(server);
+        return result;
+    }
+
+    int out[2];
+    if (pipe2(out, O_CLOEXEC) != 0) {
+        result.error = std::string("pipe: ") + strerror(errno);
+        stopProcess(server);
+        return result;
+    }
+    double serverCpuBefore = processCpuSeconds(server);
+    Clock::time_point started = Clock::now();
+    pid_t loadgen = spawn(loadArgs, out[1]);
+    close(out[1]);
+
+    // Collect the load generator's output, sampling the server meanwhile
+    std::string output;
+    char buf[4096];
+    pollfd pfd{out[0], POLLIN, 0};
+    while (loadgen > 0) {
+        int n = poll(&pfd, 1, SAMPLE_MS);
+        if (n > 0) {
+            ssize_t len = read(out[0], buf, sizeof(buf));
+            if (len <= 0) break;
+            output.append(buf, (size_t)len);
+        }
+        result.serverRssKb = std::max(result.serverRssKb, processPeakRssKb(server));
+    }
+    close(out[0]);
+
+    int status = 0;
+    rusage usage{};
+    if (loadgen > 0) wait4(loadgen, &status, 0, &usage);
+    result.wallSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+    result.serverCpuSeconds = processCpuSeconds(server) - serverCpuBefore;
+    result.serverRssKb = std::max(result.serverRssKb, processPeakRssKb(server));
+    result.loadgenCpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                               usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    result.loadgenRssKb = usage.ru_maxrss;
+    stopProcess(server);
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+
+    size_t brace = output.rfind('{');
+    if (loadgen < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || brace == std::string::npos) {
+        result.error = "chat_loadgen failed";
+        return result;
+    }
+    result.loadgen = parseFlatJson(output.substr(brace));
+    result.ok = true;
+    return result;
+}
+
+void printTable(std::ostream &out, const std::vector<ScenarioResult> &results) {
+    out << "\n" << std::left << std::setw(14) << "scenario" << std::right
+              << std::setw(8) << "logins" << std::setw(10) << "login p99"
+              << std::setw(10) << "sent/s" << std::setw(11) << "recv/s"
+              << std::setw(12) << "lat p50" << std::setw(12) << "lat p99"
+              << std::setw(10) << "srv CPU" << std::setw(10) << "srv RSS"
+              << std::setw(10) << "gen CPU" << "\n";
+    out << std::string(107, '-') << "\n";
+    for (const ScenarioResult &r : results) {
+        out << std::left << std::setw(14) << r.name << std::right;
+        if (!r.ok) {
+            out << "  " << r.error << "\n";
+            continue;
+        }
+        double wall = r.wallSeconds > 0 ? r.wallSeconds : 1;
+        auto ms = [&](const char *key) { return r.field(key) / 1000; };
+        out << std::fixed << std::setprecision(0)
+                  << std::setw(8) << r.field("logins")
+                  << std::setprecision(1) << std::setw(8) << ms("login_p99_us") << "ms"
+                  << std::setprecision(0) << std::setw(10) << r.field("sent_per_s")
+                  << std::setw(11) << r.field("received_per_s")
+                  << std::setprecision(2) << std::setw(10) << ms("latency_p50_us") << "ms"
+                  << std::setw(10) << ms("latency_p99_us") << "ms"
+                  << std::setprecision(0) << std::setw(9) << 100 * r.serverCpuSeconds / wall << "%"
+                  << std::setw(8) << r.serverRssKb / 1024 << "MB"
+                  << std::setw(9) << 100 * r.loadgenCpuSeconds / wall << "%" << "\n";
+    }
+    out << "(latencies from --latency scenarios only; CPU in percent of one core)" << std::endl;
+}
+
+/**
+ * @brief The commit being measured ("unknown" outside a git checkout).
+ */
+std::string gitCommit() {
+    std::string commit;
+    if (FILE *git = popen("git rev-parse --short HEAD 2>/dev/null", "r")) {
+        char buf[64];
+        if (fgets(buf, sizeof(buf), git)) commit = buf;
+        pclose(git);
+    }
+    while (!commit.empty() && (commit.back() == '\n' || commit.back() == '\r')) commit.pop_back();
+    return commit.empty() ? "unknown" : commit;
+}
+
+void writeJson(std::ostream &out, const BenchConfig &cfg, const std::vector<ScenarioResult> &results) {
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"commit\": \"" << gitCommit() << "\",\n"
+        << "    \"server\": \"" << cfg.server << "\",\n"
+        << "    \"transport\": \"" << (cfg.unixSocket ? "unix" : "tcp") << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "\n"
+        << "  },\n  \"scenarios\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ScenarioResult &r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"ok\": " << (r.ok ? "true" : "false");
+        if (!r.ok) {
+            out << ", \"error\": \"" << r.error << "\"}";
+            continue;
+        }
+        out << std::fixed << std::setprecision(3)
+            << ", \"wall_s\": " << r.wallSeconds
+            << ", \"server_cpu_s\": " << r.serverCpuSeconds
+            << ", \"server_peak_rss_kb\": " << r.serverRssKb
+            << ", \"loadgen_cpu_s\": " << r.loadgenCpuSeconds
+            << ", \"loadgen_peak_rss_kb\": " << r.loadgenRssKb
+            << ",\n     \"loadgen\": {";
+        bool first = true;
+        out << std::defaultfloat << std::setprecision(12);
+        for (const auto &[key, value] : r.loadgen) {
+            out << (first ? "" : ", ") << "\"" << key << "\": " << value;
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/**
+ * @brief Raises the open-file limit; the servers and chat_loadgen inherit it.
+ */
+void raiseFileLimit() {
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+void printUsage(const char *prog) {
+    std::cerr << "Usage: " << prog << " [options] [SCENARIO...]\n"
+              << "  --server native|node  Server to benchmark (default native)\n"
+              << "  --server-cmd PATH     Server binary, or the node executable\n"
+              << "                        (default ./chatserver, or node backend/server.js)\n"
+              << "  --server-arg ARG      Extra server argument, repeatable (e.g. --server-arg --io-uring)\n"
+              << "  --loadgen PATH        chat_loadgen binary (default ./chat_loadgen)\n"
+              << "  --json FILE           Also write the results as JSON (\"-\" for stdout)\n"
+              << "  --unix                Connect over the server's Unix socket instead of TCP\n"
+              << "  SCENARIO              Scenario files (default bench/*.scenario)\n";
+}
+
+/**
+ * @brief Entry point: runs every scenario and reports.
+ * @return int Exit status (0 if every scenario ran, 1 otherwise).
+ */
+int main(int argc, char **argv) {
+    BenchConfig cfg;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--unix") {
+            cfg.unixSocket = true;
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            cfg.scenarios.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--server") cfg.server = value;
+        else if (arg == "--server-cmd") cfg.serverCmd = value;
+        else if (arg == "--server-arg") cfg.serverArgs.push_back(value);
+        else if (arg == "--loadgen") cfg.loadgen = value;
+        else if (arg == "--json") cfg.jsonPath = value;
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.server != "native" && cfg.server != "node") {
+        std::cerr << "--server expects native or node" << std::endl;
+        return 1;
+    }
+    if (cfg.scenarios.empty()) cfg.scenarios = defaultScenarios();
+    if (cfg.scenarios.empty()) {
+        std::cerr << "No scenarios given and none found in bench/" << std::endl;
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    raiseFileLimit();
+
+    // With the JSON on stdout, progress and the table go to stderr
+    std::ostream &report = cfg.jsonPath == "-" ? std::cerr : std::cout;
+    std::vector<ScenarioResult> results;
+    bool allOk = true;
+    for (const std::string &path : cfg.scenarios) {
+        report << "Running " << scenarioName(path) << " against the " << cfg.server << " server"
+               << (cfg.unixSocket ? " over its Unix socket" : "") << "..." << std::endl;
+        results.push_back(runScenario(cfg, path));
+        if (!results.back().ok) {
+            std::cerr << scenarioName(path) << ": " << results.back().error << std::endl;
+            allOk = false;
+        }
+    }
+    printTable(report, results);
+
+    if (cfg.jsonPath == "-") {
+        writeJson(std::cout, cfg, results);
+    } else if (!cfg.jsonPath.empty()) {
+        std::ofstream out(cfg.jsonPath);
+        writeJson(out, cfg, results);
+        if (!out) {
+            std::cerr << "Cannot write " << cfg.jsonPath << std::endl;
+            return 1;
+        }
+    }
+    return allOk ? 0 : 1;
+}
@@ -2,167 +2,1104 @@
  * @file chat_client.cpp
  * @brief Improved Linux TCP chat client with colors and timestamps.
  * * This client uses the socket API to connect to a server (typically 127.0.0.1:4000).
- * It features multi-threading to handle sending and receiving messages concurrently.
+ * By default a single epoll loop multiplexes keyboard input and the socket;
+ * the original multi-threaded mode (one thread per direction) is kept
+ * behind the --threads flag.
  * Enhancements include:
  * 1. ANSI color codes for a better terminal experience.
  * 2. Timestamps for received messages.
  * 3. A simple login flow (sends "LOGIN <username>").
  * 4. A /quit command to gracefully exit.
+ * 5. Optional length-prefixed binary frames (--binary), see binary_frame.hpp.
+ * 6. Rooms: /join <room> and /part, with the current room shown in the prompt.
+ * 7. Direct messages: /msg <user> <text>, shown in their own color.
+ * 8. Scrollback replayed by the server after login or /join, shown dimmed.
+ * 9. Automatic reconnect with jittered exponential backoff; the client logs in
+ *    again where it left off and the server replays only the missed messages.
+ * 10. Optional compressed frames (--compress), see message_compression.hpp.
+ * 11. Configurable server endpoint (host, port, IPv4/IPv6, Unix socket) and
+ *     socket options, from the command line or CHAT_* environment variables.
  */
 
 #include <iostream>
 #include <string>
+#include <string_view> // For zero-copy access to received lines
 #include <thread>      // For creating the receiver thread
 #include <mutex>       // For safe concurrent access to std::cout
-#include <chrono>      // For timestamp generation
-#include <ctime>       // For timestamp generation (localtime)
+#include <condition_variable> // For waiting on the LOGIN reply (--binary)
 #include <iomanip>     // For I/O manipulators (though not strictly used, good for C++ I/O)
 #include <unistd.h>    // For close() (used for file descriptors/sockets)
-#include <arpa/inet.h> // For inet_pton()
-#include <sys/socket.h> // For socket(), connect(), send(), recv()
+#include <sys/socket.h> // For send(), recv()
+#include "event_poller.hpp" // For the single-threaded event-loop mode (epoll / io_uring)
+#include <poll.h>       // For waiting on the socket while output is held back
+#include <sys/eventfd.h> // For waking the receiver thread to drain sends
+#include <cerrno>       // For errno (EINTR / EPERM)
+#include <cstring>      // For strerror()
+#include <cstdio>       // For snprintf()
+#include <atomic>       // For the quit flag shared with the receiver thread
+#include "line_framer.hpp" // For splitting the byte stream into lines
+#include "chat_connection.hpp" // For connectToServer() / loginCommand()
+#include "send_queue.hpp"      // For the non-blocking outbound queue
+#include "latency_probe.hpp"   // For --latency measurement mode
+#include "terminal_renderer.hpp" // For batched terminal output
+#include "timestamp_cache.hpp"   // For cached "HH:MM" timestamps
+#include "binary_frame.hpp"      // For --binary framing
+#include "chat_rooms.hpp"        // For the default room and room replies
+#include "session_resume.hpp"    // For "+seq=<n>" / "+room=<room>" at LOGIN
+#include "reconnect_backoff.hpp" // For the delay between reconnect attempts
+#include "message_compression.hpp" // For --compress
 
 // Global mutex to protect std::cout from concurrent writes by different threads
 std::mutex coutMutex;
 
+// ====== LATENCY MODE (--latency) ======
+// Outgoing messages carry a send stamp; stamped lines from others are timed.
+bool latencyMode = false;
+uint64_t latencySeq = 0;          // Sequence number of our next message
+LatencyRecorder latencyRecorder;  // Only touched by the receiving side
+
+// ====== BINARY FRAMES (--binary) ======
+// The LOGIN line asks for "+bin"; once LOGIN_OK echoes it, both directions
+// switch to frames. Input is held back until then, since the server reads
+// everything after our LOGIN line as frames.
+bool binaryRequested = false;
+bool loginPending = false;   // LOGIN sent, reply not seen yet; guarded by coutMutex
+std::condition_variable loginReply; // Threaded mode: signalled when loginPending clears
+
+void startSendingFrames(); // Defined with the outbound queue below
+
+// ====== COMPRESSION (--compress) ======
+// Asks for "+z" next to "+bin"; frames the server deflated are inflated on
+// arrival, and the ratio achieved is printed at exit.
+bool compressRequested = false;
+MessageDecompressor inflater;         // Only touched by the receiving side
+std::string inflatedLine;             // Reused output of inflater
+CompressionStats receivedCompression; // Only touched by the receiving side
+
+// ====== RECONNECT ======
+// A dropped connection is re-established after a jittered, growing delay.
+// Every LOGIN carries "+seq=<highest sequence seen>" (and "+room=<room>"
+// outside the lobby), so after a reconnect the server puts us back in our
+// room and replays only what we missed (session_resume.hpp).
+ServerEndpoint serverEndpoint;           // Where to connect; resolved once in main()
+bool reconnectEnabled = true;            // --no-reconnect turns this off
+bool useIoUring = false;                 // --io-uring: event loop waits through io_uring
+ReconnectBackoff backoff;                // Reset by every successful login
+std::string loginName;                   // Empty until the user entered it
+uint64_t lastSeq = 0;                    // Highest broadcast sequence received
+bool numberedLines = false;              // Server accepted "+seq": text lines start with "#<seq> "
+std::atomic<bool> quitRequested{false};  // /quit or end of input: never reconnect
+
 // ====== COLOR CODES (FEATURE 1) ======
 // ANSI Escape Codes for text coloring in the terminal
-#define RESET   "\033[0m"  // Resets color and attributes to default
-#define CYAN    "\033[36m"  // Messages from others (e.g., other users)
-#define GREEN   "\033[32m"  // Server system messages (e.g., connect/disconnect)
-#define YELLOW  "\033[33m"  // Your own message prompt prefix
+#define RESET   "\033[0m"  // Resets color and attributes to default
+#define CYAN    "\033[36m"  // Messages from others (e.g., other users)
+#define GREEN   "\033[32m"  // Server system messages (e.g., connect/disconnect)
+#define YELLOW  "\033[33m"  // Your own message prompt prefix
+#define MAGENTA "\033[35m"  // Whispers sent or received with /msg
+#define DIM     "\033[2m"   // Scrollback: messages sent before you arrived
 
 // ====== TIMESTAMP FUNCTION (FEATURE 2) ======
+// "HH:MM" by default; --timestamps sec|ms (or --latency) selects finer formats.
+TimestampFormat timestampFormat = TimestampFormat::Minutes;
+
+/**
+ * @brief Returns the current time in the configured format (e.g. "HH:MM").
+ * Local time is only recomputed when the minute changes (timestamp_cache.hpp).
+ * @return std::string_view Valid until this thread calls getTimestamp() again.
+ */
+std::string_view getTimestamp() {
+    return formatTimestamp(timestampFormat);
+}
+
+// ====== BATCHED OUTPUT ======
+// Received lines are formatted into the renderer and written with a single
+// write(2) per flush, at most once per refresh interval. In threaded mode
+// flushes happen under coutMutex so they never interleave with std::cout.
+TerminalRenderer renderer;
+bool promptPending = false; // Re-print the "You:" prompt at the next flush
+// Room shown in the prompt; follows JOIN_OK / PART_OK. Guarded by coutMutex.
+std::string currentRoom(DEFAULT_ROOM);
+size_t historyLeft = 0;     // Scrollback lines still to come after "HISTORY <n>"
+
+void openSession(); // Defined with the outbound queue below
+
+/**
+ * @brief The LOGIN line for loginName, resuming after lastSeq if enabled.
+ * The server confirms the room with JOIN_OK, so until then we are in the lobby.
+ * In threaded mode the caller must hold coutMutex.
+ */
+std::string sessionLogin() {
+    std::string cmd = loginCommand(loginName, binaryRequested);
+    if (compressRequested) cmd.append(" ").append(COMPRESSION_CAPABILITY);
+    if (reconnectEnabled) {
+        appendResumeCapabilities(cmd, lastSeq, currentRoom == DEFAULT_ROOM ? "" : currentRoom);
+    }
+    currentRoom = DEFAULT_ROOM;
+    return cmd;
+}
+
+/**
+ * @brief Queues the "[room] You:" prompt.
+ * In threaded mode the caller must hold coutMutex.
+ */
+void appendPrompt() {
+    renderer.append(YELLOW "[");
+    renderer.append(currentRoom);
+    renderer.append("] You: " RESET);
+}
+
+/**
+ * @brief Updates currentRoom from the server's reply to /join or /part.
+ */
+void trackRoom(std::string_view line) {
+    std::string_view room = line.substr(line.find(' ') + 1);
+    if (line.substr(0, 8) == "JOIN_OK " && isValidRoomName(room)) currentRoom = room;
+    else if (line.substr(0, 8) == "PART_OK " && isValidRoomName(room)) currentRoom = DEFAULT_ROOM;
+}
+
+/**
+ * @brief Formats one received line with a timestamp and color coding.
+ * @param line A single message, without its "\n" terminator.
+ * @param timestamp Pre-formatted "HH:MM" time for this batch of lines.
+ * @param history The line is replayed scrollback.
+ */
+void printMessage(std::string_view line, std::string_view timestamp, bool history = false) {
+    // Color rules: scrollback, "SERVER:" notices, "WHISPER ..." direct messages, the rest
+    const char *color = CYAN;
+    LineStyle style = classifyLine(line);
+    if (history) color = DIM;
+    else if (style == LineStyle::Notice) color = GREEN;
+    else if (style == LineStyle::Whisper) color = MAGENTA;
+    renderer.append("\n[");
+    renderer.append(timestamp);
+    renderer.append("] ");
+    renderer.append(color);
+    renderer.append(line);
+    renderer.append(RESET);
+}
+
+/**
+ * @brief Bytes received from the server: "\n" lines until the server accepts
+ * "+bin", frames from the byte after that LOGIN_OK on.
+ */
+struct ServerInput {
+    LineFramer lines;
+    FrameDecoder frames;
+    bool framed = false;
+    bool inflating = false; // Server accepted "+z": frames may be deflated
+    bool corrupt = false;   // Oversized or undecodable frame: treat like a disconnect
+
+    char *writePtr() { return framed ? frames.writePtr() : lines.writePtr(); }
+    size_t writable() const { return framed ? frames.writable() : lines.writable(); }
+    void commit(size_t n) {
+        if (framed) frames.commit(n);
+        else lines.commit(n);
+    }
+    std::string_view pending() const { return framed ? std::string_view() : lines.pending(); }
+};
+
+/**
+ * @brief Formats every complete line (or TEXT frame) received so far.
+ * Nothing is written until flushOutput(); the "You:" prompt is queued to be
+ * re-printed after the lines if anything was shown.
+ * @param in Bytes received so far.
+ * @param showPrompt false while the user is still typing their username.
+ * @return true if at least one line was queued.
+ */
+bool printReceived(ServerInput &in, bool showPrompt = true) {
+    std::string_view timestamp; // Formatted once per batch, not once per line
+    bool printed = false;
+    uint64_t receivedNs = latencyMode ? monotonicNanos() : 0;
+    auto show = [&](std::string_view line, uint64_t seq) {
+        if (seq > lastSeq) lastSeq = seq;
+        bool history = historyLeft > 0;
+        if (history) --historyLeft;
+        else if (parseHistoryHeader(line, historyLeft)) return;
+        // Replayed messages are old; they would distort the latency report
+        if (latencyMode && !history) latencyRecorder.observe(line, receivedNs);
+        trackRoom(line);
+        if (!printed) timestamp = getTimestamp();
+        printMessage(line, timestamp, history);
+        printed = true;
+    };
+
+    std::string_view line;
+    while (!in.framed && in.lines.nextLine(line)) {
+        if (line.empty()) continue;
+        bool reply = loginPending && (line.substr(0, 6) == "ERROR " || line.substr(0, 9) == "LOGIN_OK ");
+        if (!reply) {
+            uint64_t seq = 0;
+            if (numberedLines) parseSequencePrefix(line, seq);
+            show(line, seq);
+            continue;
+        }
+
+        // First reply to our LOGIN: "LOGIN_OK +bin +seq Welcome, ..." echoes
+        // what the server accepted; with "+bin", frames follow this line
+        loginPending = false;
+        bool framed = false;
+        std::string shown = stripAcceptedCapabilities(line, framed, numberedLines, in.inflating);
+        if (line.substr(0, 9) == "LOGIN_OK ") backoff.reset();
+        show(shown, 0);
+        if (framed && binaryRequested) {
+            // Whatever followed LOGIN_OK in this read is already framed
+            std::string_view rest = in.lines.pending();
+            in.frames.append(rest.data(), rest.size());
+            in.lines.clear();
+            in.framed = true;
+            startSendingFrames();
+        }
+        openSession();
+    }
+
+    FrameHeader header;
+    std::string_view payload;
+    FrameDecoder::Result r = FrameDecoder::Result::NeedMore;
+    while (in.framed && (r = in.frames.next(header, payload)) == FrameDecoder::Result::Frame) {
+        if (header.type != FRAME_TEXT || payload.empty()) continue;
+        std::string_view text = payload;
+        if (header.flags & FRAME_FLAG_DEFLATE) {
+            if (!inflater.decompress(payload, inflatedLine)) {
+                in.corrupt = true;
+                break;
+            }
+            text = inflatedLine;
+        }
+        if (in.inflating) receivedCompression.add(FRAME_HEADER_SIZE + text.size(), FRAME_HEADER_SIZE + payload.size());
+        show(text, header.sequence);
+    }
+    if (r == FrameDecoder::Result::Error) in.corrupt = true;
+
+    if (printed && showPrompt) promptPending = true;
+    return printed;
+}
+
 /**
- * @brief Generates a formatted timestamp string in "HH:MM" format.
- * @return std::string The formatted time string.
+ * @brief Whether queued output is waiting for the next flush.
  */
-std::string getTimestamp() {
-    // Get current time point
-    auto now = std::chrono::system_clock::now();
-    // Convert time point to time_t (C-style time)
-    std::time_t t = std::chrono::system_clock::to_time_t(now);
-    // Convert time_t to local time structure (tm)
-    std::tm *tmPtr = std::localtime(&t);
+bool outputPending() {
+    return promptPending || !renderer.empty();
+}
 
-    char buffer[16];
-    // Format the time structure into HH:MM string and store in buffer
-    std::strftime(buffer, sizeof(buffer), "%H:%M", tmPtr);
-    return std::string(buffer);
+/**
+ * @brief Writes all queued output (and the prompt) to the terminal.
+ * In threaded mode the caller must hold coutMutex.
+ */
+void flushOutput() {
+    if (promptPending) {
+        // Re-print the "You:" prompt after the received messages
+        renderer.append("\n");
+        appendPrompt();
+        promptPending = false;
+    }
+    renderer.flush();
+}
+
+/**
+ * @brief Prints the final partial line (if any) and the disconnect notice.
+ * In threaded mode the caller must hold coutMutex.
+ * @param reconnecting A reconnect notice follows on the next line.
+ */
+void printDisconnected(ServerInput &in, bool reconnecting = false) {
+    loginPending = false; // No reply is coming any more
+    flushOutput();
+    // A final line without "\n" is still worth showing
+    if (!in.pending().empty()) printMessage(in.pending(), getTimestamp());
+    renderer.append(reconnecting ? "\nDisconnected from server." : "\nDisconnected from server.\n");
+    renderer.flush();
+}
+
+/**
+ * @brief Forgets what was received on a connection that is gone.
+ * In threaded mode the caller must hold coutMutex.
+ */
+void resetServerInput(ServerInput &in) {
+    in = ServerInput();
+    numberedLines = false;
+    historyLeft = 0;
+}
+
+// ====== OUTBOUND QUEUE ======
+// All outgoing lines go through sendQueue: "\n" framing, partial writes and
+// EAGAIN are handled there, and a slow server never blocks the input side.
+// Guarded by sendMutex because in threaded mode the receiver thread drains
+// what the input thread could not send.
+SendQueue sendQueue;
+std::mutex sendMutex;
+bool backlogReported = false;   // "Server is slow" shown for the current backlog
+int wakeFd = -1;                // Threaded mode: wakes the receiver to drain sendQueue
+bool binaryActive = false;      // Server accepted "+bin": queue frames, not lines
+uint64_t frameSeq = 0;          // Sequence number of our last frame
+bool sessionOpen = true;        // Logged in (or yet to log in) on a live connection
+
+constexpr size_t SEND_WARN_BYTES = 64 * 1024;    // Tell the user once this much waits
+constexpr size_t SEND_LIMIT_BYTES = 1024 * 1024; // Refuse new messages beyond this
+
+enum class SendResult {
+    Sent,      // Everything queued so far reached the kernel
+    Queued,    // Some bytes wait for the socket to become writable
+    Rejected,  // Queue limit reached; the message was dropped
+    Offline,   // Reconnecting; the message was dropped
+    Failed     // Socket error (server gone)
+};
+
+/**
+ * @brief Outcome of a send or flush, plus a backpressure notice for the user.
+ */
+struct SendStatus {
+    SendResult result;
+    const char *notice = nullptr; // Non-null if the user should be told something
+};
+
+/**
+ * @brief Flushes sendQueue and works out which notice (if any) is due.
+ * The caller must hold sendMutex.
+ */
+SendStatus flushLocked(int clientSocket) {
+    switch (sendQueue.flush(clientSocket)) {
+    case SendQueue::Status::Error:
+        // With reconnects on, the receiving side notices the drop and reconnects
+        if (reconnectEnabled) return {SendResult::Offline, "Message not sent: the connection was lost."};
+        return {SendResult::Failed};
+    case SendQueue::Status::Drained:
+        if (backlogReported) {
+            backlogReported = false;
+            return {SendResult::Sent, "Server caught up: all queued messages were sent."};
+        }
+        return {SendResult::Sent};
+    case SendQueue::Status::Blocked:
+        break;
+    }
+    if (!backlogReported && sendQueue.bytesQueued() >= SEND_WARN_BYTES) {
+        backlogReported = true;
+        return {SendResult::Queued, "Server is slow: your messages are queued and will be sent when it catches up."};
+    }
+    return {SendResult::Queued};
+}
+
+/**
+ * @brief Queues one line for the server and sends as much as possible now.
+ * In threaded mode a remaining backlog wakes the receiver thread, which
+ * keeps draining it while the input thread goes back to std::getline().
+ */
+SendStatus sendLine(int clientSocket, std::string_view line) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    if (!sessionOpen) {
+        return {SendResult::Offline, "Message not sent: reconnecting to the server."};
+    }
+    if (sendQueue.bytesQueued() + line.size() > SEND_LIMIT_BYTES) {
+        return {SendResult::Rejected, "Message not sent: too many messages are still waiting for the server."};
+    }
+    if (binaryActive) {
+        std::string frame;
+        appendFrame(frame, FRAME_TEXT, ++frameSeq, line);
+        sendQueue.pushRaw(std::move(frame));
+    } else {
+        sendQueue.push(line);
+    }
+    SendStatus status = flushLocked(clientSocket);
+    if (status.result == SendResult::Queued && wakeFd >= 0) {
+        uint64_t one = 1;
+        (void)!write(wakeFd, &one, sizeof(one));
+    }
+    return status;
+}
+
+/**
+ * @brief Sends a LOGIN line; unlike sendLine() it also works before the
+ * session is open, i.e. right after a reconnect.
+ */
+SendStatus sendLogin(int clientSocket, std::string_view line) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    sendQueue.push(line);
+    return flushLocked(clientSocket);
+}
+
+/**
+ * @brief Accepts messages again; called on the reply to LOGIN.
+ */
+void openSession() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    sessionOpen = true;
+}
+
+/**
+ * @brief Drops the send state of a lost connection. Queued bytes are
+ * discarded (part of them may have reached the server), and messages are
+ * refused until the next LOGIN reply.
+ */
+void closeSession() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    sendQueue.clear();
+    backlogReported = false;
+    binaryActive = false;
+    frameSeq = 0;
+    sessionOpen = false;
+}
+
+bool sessionIsOpen() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return sessionOpen;
+}
+
+/**
+ * @brief Frames every later sendLine(); called when LOGIN_OK accepts "+bin".
+ */
+void startSendingFrames() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    binaryActive = true;
+}
+
+/**
+ * @brief Retries the backlog once the socket is writable again.
+ */
+SendStatus flushSendQueue(int clientSocket) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return flushLocked(clientSocket);
+}
+
+bool sendPending() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return !sendQueue.empty();
+}
+
+/**
+ * @brief Queues one chat message, prefixed with a latency stamp in --latency mode.
+ * Commands such as /join are always sent as typed.
+ */
+SendStatus sendChatMessage(int clientSocket, std::string_view message) {
+    if (!latencyMode || message[0] == '/') return sendLine(clientSocket, message);
+
+    std::string stamped;
+    appendLatencyStamp(stamped, latencySeq++, monotonicNanos());
+    stamped.push_back(' ');
+    stamped.append(message);
+    return sendLine(clientSocket, stamped);
+}
+
+/**
+ * @brief Queues a notice line (e.g. backpressure warnings) for the terminal.
+ * In threaded mode the caller must hold coutMutex.
+ */
+void printNotice(const char *notice) {
+    if (!notice) return;
+    renderer.append("\n" YELLOW);
+    renderer.append(notice);
+    renderer.append(RESET);
+    promptPending = true;
+}
+
+/**
+ * @brief Queues "Reconnecting in 1.3 s..." (after the reason, if any).
+ * In threaded mode the caller must hold coutMutex.
+ */
+void printReconnecting(uint32_t delayMs, const char *reason = nullptr) {
+    char notice[160];
+    snprintf(notice, sizeof(notice), "%s%sReconnecting in %.1f s...",
+             reason ? reason : "", reason ? ". " : "", delayMs / 1000.0);
+    printNotice(notice);
+}
+
+/**
+ * @brief Threaded mode: waits out the backoff and connects again.
+ * The new socket takes over socketFd (dup2), so the input thread keeps
+ * using the same descriptor. The LOGIN is sent right away.
+ * @return false if the user quit in the meantime.
+ */
+bool reconnectInPlace(int socketFd, ServerInput &input) {
+    closeSession();
+    const char *reason = nullptr;
+    std::string error;
+    while (!quitRequested) {
+        uint32_t delay = backoff.nextDelayMs();
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            printReconnecting(delay, reason);
+            flushOutput();
+        }
+        // The input thread writes wakeFd when the user quits
+        pollfd wake = {wakeFd, POLLIN, 0};
+        if (poll(&wake, 1, (int)delay) > 0) {
+            uint64_t count;
+            (void)!read(wakeFd, &count, sizeof(count));
+        }
+        if (quitRequested) break;
+
+        std::string warning; // Already reported for the first connection
+        int fd = connectToEndpoint(serverEndpoint, false, warning);
+        if (fd < 0) {
+            error = std::string("Reconnect failed: ") + strerror(errno);
+            reason = error.c_str();
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(coutMutex);
+        resetServerInput(input);
+        {
+            std::lock_guard<std::mutex> sendLock(sendMutex);
+            dup2(fd, socketFd);
+        }
+        close(fd);
+        loginPending = true;
+        sendLogin(socketFd, sessionLogin());
+        return true;
+    }
+    return false;
 }
 
 /**
  * @brief Handles receiving messages from the server.
  * This function runs in a separate thread.
- * It constantly listens for incoming data and prints it to the console
- * with a timestamp and color coding.
+ * It constantly listens for incoming data, splits it into "\n"-terminated
+ * lines and prints each line with its own timestamp and color. Lines that
+ * arrive within one refresh interval are written to the terminal together.
+ * It also drains the outbound queue whenever the input thread left a backlog,
+ * and reconnects when the connection drops.
  * @param socketFd The file descriptor of the connected socket.
  */
 void receiveMessages(int socketFd) {
-    char buffer[1024];
-    while (true) {
-        // Attempt to receive data from the socket. Block until data is available.
-        int bytesReceived = recv(socketFd, buffer, sizeof(buffer) - 1, 0);
-        
-        if (bytesReceived > 0) {
-            buffer[bytesReceived] = '\0'; // Null-terminate the received data
-
-            std::string msg(buffer);
-            std::string ts = "[" + getTimestamp() + "] "; // Get and format timestamp
-
-            // Lock the mutex to ensure safe output to the console
-            std::lock_guard<std::mutex> lock(coutMutex);
-
-            // Color rules: Check if the message starts with "SERVER:"
-            if (msg.rfind("SERVER:", 0) == 0) {
-                // System message: Use GREEN color
-                std::cout << "\n" << ts << GREEN << msg << RESET << std::endl;
-            } else {
-                // Regular message from another user: Use CYAN color
-                std::cout << "\n" << ts << CYAN << msg << RESET << std::endl;
-            }
-
-            // Re-print the "You:" prompt after a message is received
-            std::cout << YELLOW << "You: " << RESET;
-        } 
-        else {
-            // bytesReceived <= 0 means an error or disconnection occurred
-            std::lock_guard<std::mutex> lock(coutMutex);
-            std::cout << "\nDisconnected from server." << std::endl;
-            break; // Exit the loop and the thread
-        }
-    }
+    // Reassembles lines (or frames) across recv() calls; views into its buffers
+    ServerInput input;
+
+    while (true) {
+        // Wait for server data, room in the socket buffer (only while a send
+        // backlog exists), a wake-up from the input thread, or the next
+        // permitted terminal refresh.
+        pollfd fds[2] = {
+            {socketFd, (short)(POLLIN | (sendPending() ? POLLOUT : 0)), 0},
+            {wakeFd, POLLIN, 0},
+        };
+        int timeout = -1;
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            if (outputPending()) timeout = renderer.msUntilDue();
+        }
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR) break;
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t count;
+            (void)!read(wakeFd, &count, sizeof(count));
+        }
+        // Quit while (re)logging in: no BYE is coming
+        if (quitRequested && !sessionIsOpen()) break;
+
+        bool lost = false;
+        {
+            // Lock the mutex to ensure safe output to the console
+            std::lock_guard<std::mutex> lock(coutMutex);
+
+            if (fds[0].revents & POLLOUT) {
+                printNotice(flushSendQueue(socketFd).notice);
+            }
+
+            if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+                char *dst = input.writePtr(); // Must run before writable()
+                ssize_t bytesReceived = recv(socketFd, dst, input.writable(), MSG_DONTWAIT);
+
+                if (bytesReceived > 0) {
+                    input.commit(bytesReceived);
+                    printReceived(input);
+                    if (!loginPending) loginReply.notify_all();
+                }
+                if (input.corrupt || bytesReceived == 0 ||
+                    (bytesReceived < 0 && errno != EAGAIN && errno != EINTR)) {
+                    // An error or disconnection occurred
+                    lost = true;
+                    printDisconnected(input, reconnectEnabled && !quitRequested);
+                    loginReply.notify_all();
+                }
+            }
+
+            if (!lost && outputPending() && renderer.due()) flushOutput();
+        }
+        // Exit the loop and the thread unless the connection comes back
+        if (lost && (!reconnectEnabled || !reconnectInPlace(socketFd, input))) break;
+    }
+}
+
+/**
+ * @brief Classic mode: a receiver thread plus blocking std::getline() here.
+ * @param clientSocket The connected socket.
+ */
+void runThreaded(int clientSocket) {
+    // Lets this thread ask the receiver to drain a send backlog
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    // LOGIN flow: Get username from user
+    std::cout << "Enter username: ";
+    std::getline(std::cin, loginName);
+    loginPending = true; // Before the receiver can see the reply
+    sendLogin(clientSocket, sessionLogin());
+
+    // Start receiver thread: This thread will handle all incoming messages
+    std::thread receiver(receiveMessages, clientSocket);
+
+    if (binaryRequested) {
+        // Nothing else may be sent until we know how the server frames it
+        std::unique_lock<std::mutex> lock(coutMutex);
+        loginReply.wait(lock, [] { return !loginPending; });
+    }
+
+    // Sending loop: The main thread handles user input and message sending
+    std::string message;
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        appendPrompt(); // Initial prompt
+        renderer.flush();
+    }
+
+    while (true) {
+        // Get the entire line of input from the user
+        bool gotLine = (bool)std::getline(std::cin, message);
+
+        // Check for the exit command (end of input behaves like /quit)
+        if (!gotLine || message == "/quit") {
+            message = "/quit";
+            quitRequested = true;
+            // Send the quit command to the server so it can clean up
+            sendLine(clientSocket, message);
+            // Stops a receiver that is waiting to reconnect
+            uint64_t one = 1;
+            (void)!write(wakeFd, &one, sizeof(one));
+            break; // Exit the sending loop
+        }
+
+        if (message.empty()) continue; // Nothing to send
+
+        // Queue the user's message; never blocks, even if the server is slow
+        SendStatus status = sendChatMessage(clientSocket, message);
+
+        std::lock_guard<std::mutex> lock(coutMutex);
+        if (status.result == SendResult::Failed) {
+            // Handle send failure (e.g., socket closed)
+            flushOutput();
+            std::cout << "\nFailed to send message. Server may be offline." << std::endl;
+            break;
+        }
+        printNotice(status.notice);
+        if (status.notice) flushOutput();
+    }
+
+    // The receiver keeps draining the queue (e.g. "/quit") until the server
+    // closes the connection, so only close the socket once it is done.
+    receiver.join();     // Wait for the receiver thread to finish its execution
+    if (!sessionIsOpen()) std::cout << std::endl; // Quit while reconnecting
+    close(clientSocket); // Close the socket file descriptor
+    close(wakeFd);
+    wakeFd = -1;
+}
+
+/**
+ * @brief Event-loop mode: stdin and the socket multiplexed with epoll
+ * (or io_uring poll requests with --io-uring, see event_poller.hpp).
+ * Everything happens on this thread, so output needs no locking and the
+ * prompt is always printed after the messages it follows. Received lines
+ * are flushed once per wakeup, or later if the refresh cap is in effect.
+ * EPOLLOUT is only requested while the outbound queue has a backlog.
+ * After a disconnect the next attempt is a non-blocking connect, so the
+ * keyboard stays responsive (/quit) while the client waits to reconnect.
+ * @param clientSocket The connected socket.
+ */
+void runEventLoop(int clientSocket) {
+    EventPoller poller;
+    std::string error; // Also keeps the reason passed to scheduleReconnect() alive
+    if (!poller.init(useIoUring, error)) {
+        std::cerr << "Error creating the event loop: " << error << std::endl;
+        close(clientSocket);
+        return;
+    }
+
+    poller.add(clientSocket, EPOLLIN);
+    bool watchingWritable = false;
+
+    // Regular files cannot be polled (EPERM); they are always readable, so
+    // in that case stdin is simply read on every loop iteration instead.
+    bool stdinAlwaysReady = !poller.add(STDIN_FILENO, EPOLLIN) && errno == EPERM;
+    bool inputHeld = false; // --binary: stdin ignored until the LOGIN reply
+
+    // stdin is read with read(2), not std::cin, so lines are framed here too
+    LineFramer inputFramer;
+    ServerInput serverInput;
+    bool loggedIn = false;
+    bool quitting = false; // /quit sent: wait for the server's BYE and close
+    bool midLine = false;  // Server output was printed after "Enter username: "
+    bool running = true;
+    bool connecting = false;     // Reconnect in progress: waiting for EPOLLOUT
+    uint64_t reconnectAtNs = 0;  // While clientSocket < 0: time of the next attempt
+
+    // Waits out the next backoff delay before connecting again
+    auto scheduleReconnect = [&](const char *reason) {
+        uint32_t delay = backoff.nextDelayMs();
+        reconnectAtNs = monotonicNanos() + delay * 1000000ull;
+        printReconnecting(delay, reason);
+    };
+
+    // Forgets the lost connection; the loop reconnects once the delay is over
+    auto dropConnection = [&](const char *reason) {
+        poller.remove(clientSocket);
+        close(clientSocket);
+        clientSocket = -1;
+        connecting = false;
+        watchingWritable = false;
+        closeSession();
+        resetServerInput(serverInput);
+        scheduleReconnect(reason);
+    };
+
+    auto startReconnect = [&]() {
+        std::string warning; // Already reported for the first connection
+        clientSocket = connectToEndpoint(serverEndpoint, true, warning);
+        if (clientSocket < 0) {
+            error = std::string("Reconnect failed: ") + strerror(errno);
+            scheduleReconnect(error.c_str());
+            return;
+        }
+        connecting = true;
+        poller.add(clientSocket, EPOLLOUT);
+    };
+
+    // /quit while reconnecting: nobody is there to answer with BYE
+    auto quitOffline = [&]() {
+        renderer.append("\n");
+        running = false;
+    };
+
+    // Reports the outcome of a send and keeps EPOLLOUT in sync with the backlog
+    auto handleSend = [&](SendStatus status) {
+        if (status.result == SendResult::Failed) {
+            // Handle send failure (e.g., socket closed)
+            flushOutput();
+            std::cout << "\nFailed to send message. Server may be offline." << std::endl;
+            running = false;
+            return;
+        }
+        printNotice(status.notice);
+
+        // A rejected message means the queue is full, i.e. still backlogged
+        bool backlog = status.result == SendResult::Queued || status.result == SendResult::Rejected;
+        if (backlog != watchingWritable) {
+            poller.modify(clientSocket, backlog ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+            watchingWritable = backlog;
+        }
+    };
+
+    std::cout << "Enter username: " << std::flush;
+
+    epoll_event events[2];
+    while (running) {
+        // Sleep until input arrives or held-back output may be flushed
+        int timeout = (stdinAlwaysReady && !inputHeld) ? 0 : -1;
+        if (outputPending() && timeout != 0) timeout = renderer.msUntilDue();
+        if (clientSocket < 0) {
+            uint64_t now = monotonicNanos();
+            int wait = reconnectAtNs > now ? (int)((reconnectAtNs - now + 999999) / 1000000) : 0;
+            if (timeout < 0 || wait < timeout) timeout = wait;
+        }
+
+        int n = poller.wait(events, 2, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        bool stdinReady = stdinAlwaysReady;
+        for (int i = 0; i < n && running; ++i) {
+            if (events[i].data.fd == STDIN_FILENO) {
+                stdinReady = true;
+                continue;
+            }
+
+            if (connecting) {
+                // Reconnect finished: log in again where we left off
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(clientSocket, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    error = std::string("Reconnect failed: ") + strerror(err);
+                    dropConnection(error.c_str());
+                    continue;
+                }
+                connecting = false;
+                poller.modify(clientSocket, EPOLLIN);
+                if (loggedIn) {
+                    loginPending = true;
+                    handleSend(sendLogin(clientSocket, sessionLogin()));
+                } else {
+                    openSession(); // The username is still to come
+                }
+                continue;
+            }
+
+            // Socket writable again: push out the queued backlog
+            if (events[i].events & EPOLLOUT) handleSend(flushSendQueue(clientSocket));
+            if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+
+            // Socket readable: one recv() per wakeup; the poller is level-triggered
+            char *dst = serverInput.writePtr(); // Must run before writable()
+            ssize_t bytesReceived = recv(clientSocket, dst, serverInput.writable(), 0);
+            if (bytesReceived > 0) {
+                serverInput.commit(bytesReceived);
+                if (printReceived(serverInput, loggedIn) && !loggedIn) midLine = true;
+            }
+            if (bytesReceived < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            if (bytesReceived <= 0 || serverInput.corrupt) {
+                bool reconnect = reconnectEnabled && !quitting;
+                printDisconnected(serverInput, reconnect);
+                if (reconnect) dropConnection(nullptr);
+                else running = false;
+            }
+        }
+        if (running && clientSocket < 0 && monotonicNanos() >= reconnectAtNs) startReconnect();
+        if (running && outputPending() && renderer.due()) flushOutput();
+        if (!running || quitting) continue;
+
+        // Stop (and later resume) watching stdin while the "+bin" LOGIN reply is due
+        if ((loginPending && binaryRequested) != inputHeld) {
+            inputHeld = !inputHeld;
+            if (!stdinAlwaysReady) poller.modify(STDIN_FILENO, inputHeld ? 0u : (uint32_t)EPOLLIN);
+        }
+        if (inputHeld) continue;
+
+        if (stdinReady) {
+            char *dst = inputFramer.writePtr(); // Must run before writable()
+            ssize_t bytesRead = read(STDIN_FILENO, dst, inputFramer.writable());
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead <= 0) {
+                // End of input behaves like /quit
+                if (!sessionIsOpen()) quitOffline();
+                else handleSend(sendLine(clientSocket, "/quit"));
+                quitting = true;
+            } else {
+                inputFramer.commit(bytesRead);
+            }
+        }
+
+        std::string_view message;
+        while (running && !quitting && inputFramer.nextLine(message)) {
+            if (!loggedIn) {
+                // LOGIN flow: the first line is the username
+                loginName = message;
+                loggedIn = true;
+                if (clientSocket >= 0 && !connecting) {
+                    loginPending = true;
+                    handleSend(sendLogin(clientSocket, sessionLogin()));
+                }
+                flushOutput();
+                if (midLine) renderer.append("\n");
+                appendPrompt(); // Initial prompt
+                renderer.flush();
+                if (loginPending && binaryRequested) break; // Later lines wait for the reply
+                continue;
+            }
+
+            if (message.empty()) continue; // Nothing to send
+
+            // Queue the quit command or the message for the server
+            if (message == "/quit") {
+                if (!sessionIsOpen()) quitOffline();
+                else handleSend(sendLine(clientSocket, message));
+                quitting = true;
+            } else {
+                handleSend(sendChatMessage(clientSocket, message));
+            }
+        }
+
+        if (quitting) {
+            // Stop watching the keyboard; the loop now ends on the server's close
+            poller.remove(STDIN_FILENO);
+            stdinAlwaysReady = false;
+        }
+    }
+
+    flushOutput();
+    if (clientSocket >= 0) close(clientSocket);
+}
+
+/**
+ * @brief Parses a whole non-negative decimal number (no sign, no suffix).
+ */
+bool parseCount(const std::string &text, int &value) {
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = std::stoi(text);
+    return true;
+}
+
+/**
+ * @brief Applies one endpoint setting, from an option or its environment variable.
+ * @param name Option name without the dashes ("port", "rcvbuf", ...).
+ * @return Empty on success, otherwise what the value should have been.
+ */
+std::string setEndpointOption(ServerEndpoint &ep, const std::string &name, const std::string &value) {
+    const char *const NUMBER = "expects a number";
+    if (name == "host") {
+        if (value.empty()) return "expects a host name";
+        ep.host = value;
+    } else if (name == "unix") {
+        sockaddr_un addr;
+        socklen_t len;
+        if (!makeUnixAddress(value, addr, len)) {
+            return "expects a socket path of 1 to " + std::to_string(sizeof(addr.sun_path) - 1) + " bytes";
+        }
+        ep.unixPath = value;
+    } else if (name == "port") {
+        if (!parseCount(value, ep.port)) return NUMBER;
+    } else if (name == "rcvbuf") {
+        if (!parseCount(value, ep.recvBuffer)) return NUMBER;
+    } else if (name == "sndbuf") {
+        if (!parseCount(value, ep.sendBuffer)) return NUMBER;
+    } else if (name == "busy-poll") {
+        if (!parseCount(value, ep.busyPollUs)) return NUMBER;
+    } else if (name == "family") {
+        if (value == "4" || value == "ipv4") ep.family = AF_INET;
+        else if (value == "6" || value == "ipv6") ep.family = AF_INET6;
+        else if (value == "any") ep.family = AF_UNSPEC;
+        else return "expects 4, 6, ipv4, ipv6 or any";
+    } else if (name == "nodelay") {
+        if (value != "0" && value != "1") return "expects 0 or 1";
+        ep.noDelay = value == "1";
+    } else {
+        return "is not an endpoint setting";
+    }
+    return "";
+}
+
+/**
+ * @brief Reads CHAT_HOST, CHAT_PORT, CHAT_FAMILY, CHAT_UNIX_SOCKET,
+ * CHAT_NODELAY, CHAT_RCVBUF, CHAT_SNDBUF and CHAT_BUSY_POLL; options given
+ * on the command line are applied afterwards and win.
+ * @return false (with a message printed) if a variable is invalid.
+ */
+bool readEndpointEnvironment(ServerEndpoint &ep) {
+    static const char *const VARIABLES[][2] = {
+        {"CHAT_HOST", "host"}, {"CHAT_PORT", "port"}, {"CHAT_FAMILY", "family"},
+        {"CHAT_UNIX_SOCKET", "unix"}, {"CHAT_NODELAY", "nodelay"}, {"CHAT_RCVBUF", "rcvbuf"},
+        {"CHAT_SNDBUF", "sndbuf"}, {"CHAT_BUSY_POLL", "busy-poll"}};
+    for (const auto &variable : VARIABLES) {
+        const char *value = getenv(variable[0]);
+        if (!value || !*value) continue;
+        std::string error = setEndpointOption(ep, variable[1], value);
+        if (!error.empty()) {
+            std::cerr << variable[0] << " " << error << ", got " << value << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
 /**
  * @brief The main execution function for the chat client.
+ * Usage: chatclient [--threads | --io-uring] [--binary] [--compress] [--latency]
+ *                   [--timestamps min|sec|ms] [--no-reconnect]
+ *                   [--host NAME] [--port N] [-4 | -6] [--unix PATH]
+ *                   [--nodelay] [--rcvbuf BYTES] [--sndbuf BYTES] [--busy-poll US]
+ *   --threads     Use the classic receiver-thread mode instead of the epoll loop.
+ *   --io-uring    Let the event loop wait through io_uring instead of epoll.
+ *   --binary      Ask the server for length-prefixed binary frames at LOGIN
+ *                 (falls back to text lines if it does not offer them).
+ *   --compress    Like --binary, and also ask for deflated frames ("+z");
+ *                 prints the compression ratio achieved at exit.
+ *   --latency     Stamp outgoing messages and report delivery latency at exit
+ *                 (also switches timestamps to milliseconds).
+ *   --timestamps  Precision of the time shown next to each message.
+ *   --no-reconnect  Exit when the connection drops instead of reconnecting
+ *                 (the LOGIN line then carries no resume capabilities).
+ *   --host, --port  Server name or IPv4/IPv6 address, and TCP port
+ *                 (default 127.0.0.1:4000).
+ *   -4, -6        Connect over IPv4 or IPv6 only.
+ *   --unix        Connect to a Unix domain socket instead of TCP.
+ *   --nodelay     Set TCP_NODELAY.
+ *   --rcvbuf, --sndbuf  Socket buffer sizes (SO_RCVBUF / SO_SNDBUF).
+ *   --busy-poll   Busy-poll the device queue for up to US microseconds
+ *                 when receiving (SO_BUSY_POLL).
+ * Each endpoint option can also be set in the environment (see
+ * readEndpointEnvironment()); the command line wins.
  * @return int Exit status (0 for success, non-zero for error).
  */
-int main() {
-    // 1. Create socket: AF_INET (IPv4), SOCK_STREAM (TCP), 0 (Default protocol)
-    int clientSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (clientSocket < 0) {
-        std::cerr << "Error creating socket." << std::endl;
-        return 1;
-    }
-
-    // 2. Server details: Define the server's address structure
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    // htons converts the port number to network byte order
-    serverAddr.sin_port = htons(4000); 
-    // Convert "127.0.0.1" (loopback address) to binary form and store in sin_addr
-    inet_pton(AF_INET, "127.0.0.1", &serverAddr.sin_addr);
-
-    // 3. Connect to server
-    if (connect(clientSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "Failed to connect to the server. Ensure server is running." << std::endl;
-        // On connection failure, close the socket and exit
-        close(clientSocket);
-        return 1;
-    }
-
-    std::cout << GREEN << "Connected to server." << RESET << std::endl;
-
-    // 4. LOGIN flow: Get username from user
-    std::string username;
-    std::cout << "Enter username: ";
-    std::getline(std::cin, username);
-
-    // Send the login command to the server (e.g., "LOGIN Alice")
-    std::string loginCmd = "LOGIN " + username;
-    send(clientSocket, loginCmd.c_str(), loginCmd.size(), 0);
-
-    // 5. Start receiver thread: This thread will handle all incoming messages
-    std::thread receiver(receiveMessages, clientSocket);
-
-    // 6. Sending loop: The main thread handles user input and message sending
-    std::string message;
-    std::cout << YELLOW << "You: " << RESET; // Initial prompt
-
-    while (true) {
-        // Get the entire line of input from the user
-        std::getline(std::cin, message);
-
-        // Check for the exit command
-        if (message == "/quit") {
-            // Send the quit command to the server so it can clean up
-            send(clientSocket, message.c_str(), message.size(), 0);
-            break; // Exit the sending loop
-        }
-
-        // Send the user's message to the server
-        ssize_t sent = send(clientSocket, message.c_str(), message.size(), 0);
-        
-        if (sent <= 0) {
-            // Handle send failure (e.g., socket closed)
-            std::cout << "\nFailed to send message. Server may be offline." << std::endl;
-            break;
-        }
-    }
-
-    // 7. Cleanup and Exit
-    close(clientSocket); // Close the socket file descriptor
-    receiver.join();     // Wait for the receiver thread to finish its execution
-
-    return 0;
-}
\ No newline at end of file
+int main(int argc, char **argv) {
+    bool threaded = false;
+    bool explicitFormat = false; // --timestamps given; --latency must not override it
+    if (!readEndpointEnvironment(serverEndpoint)) return 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads") {
+            threaded = true;
+        } else if (arg == "--io-uring") {
+            useIoUring = true;
+        } else if (arg == "--binary") {
+            binaryRequested = true;
+        } else if (arg == "--compress") {
+            binaryRequested = compressRequested = true;
+        } else if (arg == "--no-reconnect") {
+            reconnectEnabled = false;
+        } else if (arg == "--latency") {
+            latencyMode = true;
+            if (!explicitFormat) timestampFormat = TimestampFormat::Milliseconds;
+        } else if (arg == "--timestamps" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "min") timestampFormat = TimestampFormat::Minutes;
+            else if (value == "sec") timestampFormat = TimestampFormat::Seconds;
+            else if (value == "ms") timestampFormat = TimestampFormat::Milliseconds;
+            else {
+                std::cerr << "--timestamps expects min, sec or ms" << std::endl;
+                return 1;
+            }
+            explicitFormat = true;
+        } else if (arg == "-4" || arg == "-6") {
+            serverEndpoint.family = arg == "-4" ? AF_INET : AF_INET6;
+        } else if (arg == "--nodelay") {
+            serverEndpoint.noDelay = true;
+        } else if ((arg == "--host" || arg == "--port" || arg == "--unix" || arg == "--rcvbuf" ||
+                    arg == "--sndbuf" || arg == "--busy-poll") && i + 1 < argc) {
+            std::string value = argv[++i];
+            std::string error = setEndpointOption(serverEndpoint, arg.substr(2), value);
+            if (!error.empty()) {
+                std::cerr << arg << " " << error << ", got " << value << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads | --io-uring] [--binary] [--compress] [--latency]"
+                      << " [--timestamps min|sec|ms] [--no-reconnect]"
+                      << " [--host NAME] [--port N] [-4 | -6] [--unix PATH]"
+                      << " [--nodelay] [--rcvbuf BYTES] [--sndbuf BYTES] [--busy-poll US]" << std::endl;
+            return 1;
+        }
+    }
+    if (threaded && useIoUring) {
+        std::cerr << "--io-uring applies to the event loop, not to --threads" << std::endl;
+        return 1;
+    }
+
+    // 1. Connect to server (127.0.0.1:4000 unless configured otherwise)
+    std::string error, warning;
+    if (!resolveEndpoint(serverEndpoint, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    int clientSocket = connectToEndpoint(serverEndpoint, false, warning);
+    if (clientSocket < 0) {
+        std::cerr << "Failed to connect to the server at " << serverEndpoint.describe() << ": "
+                  << strerror(errno) << ". Ensure server is running." << std::endl;
+        return 1;
+    }
+    if (!warning.empty()) std::cerr << "Warning: " << warning << std::endl;
+
+    std::cout << GREEN << "Connected to server at " << serverEndpoint.describe() << "." << RESET << std::endl;
+
+    // 2. LOGIN, then chat until /quit or disconnect
+    if (threaded) {
+        runThreaded(clientSocket);
+    } else {
+        runEventLoop(clientSocket);
+    }
+
+    // 3. Latency report (the receiver has stopped, so no locking is needed)
+    if (latencyMode) {
+        printLatencyReport(std::cout, latencyRecorder.latencies(),
+                           latencyRecorder.lost(), latencyRecorder.reordered());
+    }
+    if (compressRequested) std::cout << "Compression: " << receivedCompression.describe() << std::endl;
+
+    return 0;
+}
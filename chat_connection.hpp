@@ -0,0 +1,215 @@
+/**
+ * @file chat_connection.hpp
+ * @brief Connect and LOGIN helpers shared by the Linux client and chat_loadgen.
+ *
+ * Both programs talk to the same server (server.js or chat_server_linux) on
+ * 127.0.0.1:4000 by default and log in with "LOGIN <username>".
+ *
+ * The client can also be pointed elsewhere (ServerEndpoint): a host name or
+ * IPv4/IPv6 address, or a Unix domain socket, with optional socket tuning.
+ * The name is resolved once, up front, so reconnects never wait on DNS.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cerrno>
+#include <cstring>      // For memcpy() / strerror()
+#include <unistd.h>     // For close()
+#include <arpa/inet.h>  // For inet_pton() / htons()
+#include <sys/socket.h> // For socket(), connect(), send()
+#include <netdb.h>      // For getaddrinfo()
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include "binary_frame.hpp" // For the "+bin" LOGIN capability
+#include "unix_socket.hpp"  // For --unix (paths and "@abstract" names)
+
+// TCP_PORT in backend/server.js
+constexpr int DEFAULT_SERVER_PORT = 4000;
+constexpr const char *DEFAULT_SERVER_HOST = "127.0.0.1";
+
+/**
+ * @brief Builds the IPv4 address of the chat server.
+ * @param host Dotted-quad IPv4 address.
+ * @param port TCP port in host byte order.
+ * @param addr Filled in on success.
+ * @return false if host is not a valid IPv4 address.
+ */
+inline bool makeServerAddress(const char *host, int port, sockaddr_in &addr) {
+    addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    // htons converts the port number to network byte order
+    addr.sin_port = htons(port);
+    // Convert the text address to binary form and store in sin_addr
+    return inet_pton(AF_INET, host, &addr.sin_addr) == 1;
+}
+
+/**
+ * @brief Creates a TCP socket and connects it to the chat server.
+ * @param nonBlocking Open the socket with O_NONBLOCK; the connect may then
+ *        still be in progress (wait for EPOLLOUT and check SO_ERROR).
+ * @return The socket, or -1 with errno set.
+ */
+inline int connectToServer(const char *host = DEFAULT_SERVER_HOST,
+                           int port = DEFAULT_SERVER_PORT,
+                           bool nonBlocking = false) {
+    sockaddr_in serverAddr;
+    if (!makeServerAddress(host, port, serverAddr)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // AF_INET (IPv4), SOCK_STREAM (TCP), 0 (Default protocol)
+    int type = SOCK_STREAM | SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0);
+    int fd = socket(AF_INET, type, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0 &&
+        !(nonBlocking && errno == EINPROGRESS)) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Formats the login command (e.g., "LOGIN Alice"), without the "\n" terminator.
+ * @param binary Append the "+bin" capability to ask for binary frames.
+ */
+inline std::string loginCommand(std::string_view username, bool binary = false) {
+    std::string cmd = "LOGIN ";
+    cmd.append(username);
+    if (binary) cmd.append(" ").append(BINARY_CAPABILITY);
+    return cmd;
+}
+
+/**
+ * @brief Where the client connects, and the socket options it sets.
+ */
+struct ServerEndpoint {
+    std::string host = DEFAULT_SERVER_HOST; // Name or IPv4/IPv6 address
+    int port = DEFAULT_SERVER_PORT;
+    int family = AF_UNSPEC;  // AF_INET or AF_INET6 to use only that family
+    std::string unixPath;    // Non-empty: connect to this Unix socket ("@name": abstract) instead
+
+    bool noDelay = false;    // TCP_NODELAY: send small messages without waiting
+    int recvBuffer = 0;      // SO_RCVBUF in bytes (0 = kernel default)
+    int sendBuffer = 0;      // SO_SNDBUF in bytes (0 = kernel default)
+    int busyPollUs = 0;      // SO_BUSY_POLL: spin on the device queue in recv()
+
+    // Filled in by resolveEndpoint(); tried in order
+    std::vector<sockaddr_storage> addresses;
+    std::vector<socklen_t> addressLengths;
+    size_t preferred = 0;    // The address that last connected
+
+    /**
+     * @brief "127.0.0.1:4000", "[::1]:4000" or "unix:/run/chat.sock", for messages.
+     */
+    std::string describe() const {
+        if (!unixPath.empty()) return "unix:" + unixPath;
+        bool ipv6 = host.find(':') != std::string::npos;
+        return (ipv6 ? "[" + host + "]" : host) + ":" + std::to_string(port);
+    }
+};
+
+/**
+ * @brief Resolves the endpoint's host (or Unix path) into its address list.
+ * @return false with error set if nothing usable was found.
+ */
+inline bool resolveEndpoint(ServerEndpoint &ep, std::string &error) {
+    ep.addresses.clear();
+    ep.addressLengths.clear();
+    ep.preferred = 0;
+
+    if (!ep.unixPath.empty()) {
+        sockaddr_un un;
+        socklen_t len;
+        if (!makeUnixAddress(ep.unixPath, un, len)) {
+            error = "Invalid Unix socket path: " + ep.unixPath;
+            return false;
+        }
+        sockaddr_storage addr{};
+        memcpy(&addr, &un, sizeof(un));
+        ep.addresses.push_back(addr);
+        ep.addressLengths.push_back(len);
+        return true;
+    }
+
+    if (ep.port <= 0 || ep.port > 65535) {
+        error = "Invalid port: " + std::to_string(ep.port);
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = ep.family;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG | AI_NUMERICSERV;
+    addrinfo *results = nullptr;
+    int rc = getaddrinfo(ep.host.c_str(), std::to_string(ep.port).c_str(), &hints, &results);
+    if (rc != 0) {
+        error = "Cannot resolve " + ep.host + ": " + gai_strerror(rc);
+        return false;
+    }
+    for (addrinfo *ai = results; ai; ai = ai->ai_next) {
+        sockaddr_storage addr{};
+        memcpy(&addr, ai->ai_addr, ai->ai_addrlen);
+        ep.addresses.push_back(addr);
+        ep.addressLengths.push_back(ai->ai_addrlen);
+    }
+    freeaddrinfo(results);
+    return true;
+}
+
+/**
+ * @brief Applies the endpoint's socket options to a new socket.
+ * A refused option (SO_BUSY_POLL above the system limit needs
+ * CAP_NET_ADMIN) only produces a warning in warning.
+ */
+inline void applySocketOptions(int fd, int family, const ServerEndpoint &ep, std::string &warning) {
+    auto set = [&](int level, int option, int value, const char *name) {
+        if (setsockopt(fd, level, option, &value, sizeof(value)) < 0 && warning.empty()) {
+            warning = std::string(name) + " not applied: " + strerror(errno);
+        }
+    };
+    if (ep.noDelay && family != AF_UNIX) set(IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    if (ep.recvBuffer > 0) set(SOL_SOCKET, SO_RCVBUF, ep.recvBuffer, "SO_RCVBUF");
+    if (ep.sendBuffer > 0) set(SOL_SOCKET, SO_SNDBUF, ep.sendBuffer, "SO_SNDBUF");
+    if (ep.busyPollUs > 0 && family != AF_UNIX) set(SOL_SOCKET, SO_BUSY_POLL, ep.busyPollUs, "SO_BUSY_POLL");
+}
+
+/**
+ * @brief Connects to a resolved endpoint.
+ * A blocking connect tries every address in turn and remembers the one
+ * that worked; a non-blocking one (reconnects from an event loop) only
+ * tries that address, and may still be in progress when it returns.
+ * @param warning Set if a socket option could not be applied.
+ * @return The socket, or -1 with errno set.
+ */
+inline int connectToEndpoint(ServerEndpoint &ep, bool nonBlocking, std::string &warning) {
+    if (ep.addresses.empty()) {
+        errno = EDESTADDRREQ;
+        return -1;
+    }
+    size_t first = nonBlocking ? ep.preferred : 0;
+    size_t last = nonBlocking ? ep.preferred + 1 : ep.addresses.size();
+    int err = ECONNREFUSED;
+    for (size_t i = first; i < last; ++i) {
+        const sockaddr_storage &addr = ep.addresses[i];
+        int type = SOCK_STREAM | SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0);
+        int fd = socket(addr.ss_family, type, 0);
+        if (fd < 0) return -1;
+        // Buffer sizes must be set before connect() to affect the TCP window
+        applySocketOptions(fd, addr.ss_family, ep, warning);
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), ep.addressLengths[i]) == 0 ||
+            (nonBlocking && errno == EINPROGRESS)) {
+            ep.preferred = i;
+            return fd;
+        }
+        err = errno;
+        close(fd);
+    }
+    errno = err;
+    return -1;
+}
@@ -0,0 +1,743 @@
+/**
+ * @file chat_loadgen.cpp
+ * @brief Headless multi-session load generator for the chat servers.
+ *
+ * Opens many non-interactive chat sessions from one process, using the same
+ * connect and LOGIN code as the Linux client (chat_connection.hpp), and
+ * drives them with a configurable workload:
+ * 1. Ramp-up: sessions are opened at a fixed rate until the target count.
+ * 2. Chat: every logged-in session sends messages at a fixed rate.
+ * 3. Churn: random sessions leave (/quit) and are replaced by new ones.
+ *
+ * All sessions share one thread and one epoll instance. Once per reporting
+ * interval it prints throughput and failure counters; a summary is printed
+ * when the run ends (after --duration seconds or on Ctrl-C).
+ *
+ * With --latency every message carries a send stamp (latency_probe.hpp) and
+ * all deliveries are timed into one histogram. Loss and reordering need
+ * per-sender state in every receiver, so only the first --probes sessions
+ * track sequence numbers.
+ *
+ * With --binary every session asks for length-prefixed frames at LOGIN
+ * (binary_frame.hpp), so text and binary framing can be compared.
+ *
+ * With --talkers N only the first N sessions send (at --rate each); the
+ * others just listen, as in a room with one hot talker or many idle users.
+ * The time from connect to LOGIN_OK is always measured, which is what a
+ * join storm stresses. --json replaces the summary with one JSON object
+ * for scripts such as chat_bench.
+ *
+ * With --unix PATH the sessions connect to the server's Unix domain socket
+ * instead of TCP, to compare the two transports for same-host bots.
+ */
+
+#include <iostream>
+#include <iomanip>     // For std::setprecision in the reports
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>      // For std::unique_ptr (per-session state)
+#include <random>      // For picking sessions to churn
+#include <chrono>      // For ramp/rate scheduling
+#include <cstring>     // For strerror()
+#include <cerrno>
+#include <csignal>     // For SIGINT / SIGPIPE handling
+#include <unistd.h>    // For close()
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h> // For raising RLIMIT_NOFILE
+#include "line_framer.hpp"
+#include "chat_connection.hpp"
+#include "latency_probe.hpp"
+#include "binary_frame.hpp"
+#include "chat_rooms.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Scheduler granularity: rates and ramp-up are applied in steps of this size
+constexpr int TICK_MS = 10;
+// Upper bound on new connections started per tick, to keep ticks short
+constexpr int MAX_OPENS_PER_TICK = 1000;
+// A session with more unsent bytes than this skips its turn to send
+constexpr size_t MAX_SESSION_BACKLOG = 64 * 1024;
+
+/**
+ * @brief Workload parameters (all settable from the command line).
+ */
+struct LoadConfig {
+    std::string host = DEFAULT_SERVER_HOST;
+    int port = DEFAULT_SERVER_PORT;
+    std::string unixPath;       // Connect here instead of host:port ("@name": abstract)
+    int sessions = 1000;        // Target number of concurrent sessions
+    double rampRate = 0;        // New sessions per second (0 = all at once)
+    double messageRate = 1.0;   // Messages per second per logged-in session
+    size_t payloadSize = 32;    // Bytes of text per message
+    double churnRate = 0;       // Leave+rejoin cycles per second
+    double duration = 30;       // Seconds to run (0 = until Ctrl-C)
+    double reportInterval = 1;  // Seconds between progress lines
+    std::string prefix = "load"; // Username prefix
+    bool latency = false;       // Stamp messages and time their delivery
+    int probes = 16;            // Sessions that also count loss/reordering
+    bool binary = false;        // Log in with "+bin" and exchange frames
+    int talkers = -1;           // Sessions that send messages (-1 = all)
+    bool json = false;          // Summary as one JSON object
+};
+
+/**
+ * @brief Counters reported per interval and at the end of the run.
+ */
+struct LoadStats {
+    uint64_t connectAttempts = 0;
+    uint64_t connectFailures = 0;  // socket()/connect() errors and refused connects
+    uint64_t loginFailures = 0;    // "ERROR ..." replies to LOGIN
+    uint64_t disconnects = 0;      // Server closed a session we did not end
+    uint64_t logins = 0;           // LOGIN_OK received
+    uint64_t binaryRefused = 0;    // --binary logins answered without "+bin"
+    uint64_t leaves = 0;           // Sessions ended by churn
+    uint64_t messagesSent = 0;
+    uint64_t linesReceived = 0;    // Every line delivered to any session
+    uint64_t historyLines = 0;     // Scrollback replayed after LOGIN_OK (not in linesReceived)
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t sendStalls = 0;       // Turns skipped because of a send backlog
+};
+
+enum class SessionState { Connecting, LoggingIn, Active, Leaving };
+
+/**
+ * @brief One simulated user.
+ */
+struct Session {
+    int fd = -1;
+    SessionState state = SessionState::Connecting;
+    std::string username;
+    LineFramer framer{512};
+    std::string outBuf;        // Bytes the kernel did not accept yet
+    size_t outOff = 0;
+    size_t activeIndex = 0;    // Position in LoadGenerator::active while Active
+    uint64_t nextSeq = 0;      // Latency mode: sequence number of the next message
+    std::unique_ptr<SequenceTracker> sequences; // Latency mode: probe sessions only
+    std::unique_ptr<FrameDecoder> frames;       // Set once the server accepted "+bin"
+    uint64_t framesSent = 0;
+    size_t historyLeft = 0;    // Scrollback lines still to come after "HISTORY <n>"
+    bool talker = false;       // Sends messages (--talkers)
+    size_t talkerIndex = 0;    // Position in LoadGenerator::talking while Active
+    uint64_t connectNs = 0;    // When the connect started, for the login latency
+};
+
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+/**
+ * @brief Drives all sessions from a single epoll loop.
+ */
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const LoadConfig &config)
+        : cfg(config), rng(std::random_device{}()) {
+        payload.assign(cfg.payloadSize, 'x');
+        payload.push_back('\n');
+    }
+
+    /**
+     * @brief Runs the configured workload to completion.
+     * @return false if the event loop could not be created.
+     */
+    bool run() {
+        std::string error;
+        endpoint.host = cfg.host;
+        endpoint.port = cfg.port;
+        endpoint.unixPath = cfg.unixPath;
+        if (!resolveEndpoint(endpoint, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            std::cerr << "Error creating epoll instance: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        start = Clock::now();
+        Clock::time_point lastTick = start;
+        Clock::time_point nextReport = start + toDuration(cfg.reportInterval);
+        std::vector<epoll_event> events(1024);
+
+        while (!stopRequested) {
+            Clock::time_point now = Clock::now();
+            if (cfg.duration > 0 && now - start >= toDuration(cfg.duration)) break;
+
+            double dt = std::chrono::duration<double>(now - lastTick).count();
+            if (dt * 1000 >= TICK_MS) {
+                tick(now, dt);
+                lastTick = now;
+            }
+            if (now >= nextReport) {
+                if (!cfg.json) report(now);
+                nextReport += toDuration(cfg.reportInterval);
+            }
+
+            int n = epoll_wait(epollFd, events.data(), (int)events.size(), TICK_MS);
+            if (n < 0 && errno != EINTR) {
+                std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                handleEvent(events[i].data.fd, events[i].events);
+            }
+        }
+
+        summary(Clock::now());
+        for (auto &s : sessions) {
+            if (s) close(s->fd);
+        }
+        close(epollFd);
+        return true;
+    }
+
+private:
+    LoadConfig cfg;
+    ServerEndpoint endpoint;    // Resolved once by run()
+    LoadStats stats;
+    LoadStats lastReported;
+    std::mt19937 rng;
+    std::string payload;        // "xxxx...\n", shared by every message
+    std::string stamped;        // Latency mode: reused buffer for stamped messages
+    std::string framed;         // --binary: reused buffer for encoding frames
+    LatencyHistogram latencies; // Latency mode: all deliveries to all sessions
+    LatencyHistogram loginLatencies; // Connect to LOGIN_OK, every session
+    double allLoggedInAt = 0;   // Seconds until --sessions logins first completed
+    uint64_t probesOpened = 0;
+    uint64_t lostMessages = 0;      // Totals from probe sessions that have closed
+    uint64_t reorderedMessages = 0;
+    int epollFd = -1;
+    Clock::time_point start;
+    Clock::time_point lastReportTime;
+
+    // Session state indexed by file descriptor
+    std::vector<std::unique_ptr<Session>> sessions;
+    // Logged-in sessions: candidates for churn; talkers among them send
+    std::vector<Session*> active;
+    std::vector<Session*> talking;
+    size_t live = 0;            // Sessions with an open socket
+    size_t liveTalkers = 0;     // Of which talkers
+    uint64_t rampOpened = 0;    // Sessions started by the ramp-up schedule
+    uint64_t nextUserId = 0;
+    size_t sendCursor = 0;
+    double messageCredit = 0;
+    double churnCredit = 0;
+
+    static Clock::duration toDuration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    /**
+     * @brief Applies ramp-up, churn and message rates for the elapsed time.
+     */
+    void tick(Clock::time_point now, double dt) {
+        // Ramp-up: how many sessions the schedule wants started by now
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        uint64_t wanted = cfg.rampRate > 0
+            ? std::min<uint64_t>(cfg.sessions, (uint64_t)(cfg.rampRate * elapsed) + 1)
+            : cfg.sessions;
+        for (int opened = 0; rampOpened < wanted && opened < MAX_OPENS_PER_TICK; ++opened) {
+            openSession();
+            ++rampOpened;
+        }
+
+        // Churn: a random active session leaves and a new one takes its place
+        churnCredit += cfg.churnRate * dt;
+        while (churnCredit >= 1) {
+            churnCredit -= 1;
+            if (active.empty()) continue;
+            Session *s = active[std::uniform_int_distribution<size_t>(0, active.size() - 1)(rng)];
+            deactivate(*s);
+            s->state = SessionState::Leaving;
+            queueMessage(*s, "/quit\n");
+            ++stats.leaves;
+            openSession();
+        }
+        if (active.empty()) churnCredit = 0;
+
+        // Chat: spread this tick's messages round-robin over active talkers
+        messageCredit += cfg.messageRate * dt * talking.size();
+        while (messageCredit >= 1 && !talking.empty()) {
+            messageCredit -= 1;
+            Session &s = *talking[sendCursor++ % talking.size()];
+            if (s.outBuf.size() - s.outOff > MAX_SESSION_BACKLOG) {
+                ++stats.sendStalls;
+                continue;
+            }
+            if (cfg.latency) {
+                queueMessage(s, stampedPayload(s));
+            } else {
+                queueMessage(s, payload);
+            }
+            ++stats.messagesSent;
+        }
+        if (talking.empty()) messageCredit = 0;
+    }
+
+    /**
+     * @brief Starts a non-blocking connect for a new session.
+     */
+    void openSession() {
+        ++stats.connectAttempts;
+        std::string warning;
+        int fd = connectToEndpoint(endpoint, true, warning);
+        if (fd < 0) {
+            ++stats.connectFailures;
+            return;
+        }
+
+        if ((size_t)fd >= sessions.size()) sessions.resize(fd + 1);
+        sessions[fd].reset(new Session());
+        Session &s = *sessions[fd];
+        s.fd = fd;
+        s.connectNs = monotonicNanos();
+        // The first sessions opened talk, and so do the ones churn swaps in for them
+        s.talker = cfg.talkers < 0 || liveTalkers < (size_t)cfg.talkers;
+        if (s.talker) ++liveTalkers;
+        s.username = cfg.prefix + std::to_string(nextUserId++);
+        if (cfg.latency && probesOpened < (uint64_t)cfg.probes) {
+            s.sequences.reset(new SequenceTracker());
+            ++probesOpened;
+        }
+        ++live;
+
+        // Writable means the connect finished (successfully or not)
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void handleEvent(int fd, uint32_t ev) {
+        if (fd < 0 || (size_t)fd >= sessions.size() || !sessions[fd]) return;
+        Session &s = *sessions[fd];
+
+        if (s.state == SessionState::Connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0 || (ev & (EPOLLERR | EPOLLHUP))) {
+                ++stats.connectFailures;
+                closeSession(s);
+                return;
+            }
+            if (!(ev & EPOLLOUT)) return;
+            s.state = SessionState::LoggingIn;
+            queueSend(s, loginCommand(s.username, cfg.binary) + "\n");
+        }
+
+        if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            if (!handleReadable(s)) return;
+        }
+        if (ev & EPOLLOUT) flushOutput(s);
+    }
+
+    /**
+     * @brief Drains the socket and reacts to protocol lines.
+     * @return false if the session was closed.
+     */
+    bool handleReadable(Session &s) {
+        std::string_view line;
+        while (true) {
+            // Must run before writable(): writePtr() may grow the buffer
+            char *dst = s.frames ? s.frames->writePtr() : s.framer.writePtr();
+            size_t room = s.frames ? s.frames->writable() : s.framer.writable();
+            ssize_t n = recv(s.fd, dst, room, 0);
+            if (n > 0) {
+                stats.bytesReceived += n;
+                if (s.frames) {
+                    s.frames->commit(n);
+                    if (!handleFrames(s)) return false;
+                    continue;
+                }
+                s.framer.commit(n);
+                while (!s.frames && s.framer.nextLine(line)) {
+                    if (!handleLine(s, line)) return false;
+                }
+                if (s.frames) {
+                    // LOGIN_OK accepted "+bin": the rest of this read is framed
+                    std::string_view rest = s.framer.pending();
+                    s.frames->append(rest.data(), rest.size());
+                    s.framer.clear();
+                    if (!handleFrames(s)) return false;
+                }
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+
+            // Closed by the server (or reset)
+            if (s.state == SessionState::Connecting || s.state == SessionState::LoggingIn) {
+                ++stats.connectFailures;
+            } else if (s.state == SessionState::Active) {
+                ++stats.disconnects;
+            }
+            closeSession(s);
+            return false;
+        }
+    }
+
+    /**
+     * @brief Handles every complete frame buffered for a binary session.
+     * @return false if the session was closed.
+     */
+    bool handleFrames(Session &s) {
+        FrameHeader header;
+        std::string_view payload;
+        FrameDecoder::Result r;
+        while ((r = s.frames->next(header, payload)) == FrameDecoder::Result::Frame) {
+            if (header.type == FRAME_TEXT && !handleLine(s, payload)) return false;
+        }
+        if (r == FrameDecoder::Result::Error) {
+            ++stats.disconnects; // Corrupt stream: give up on the session
+            closeSession(s);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Builds "#lat:seq:ns# xxx...\n", padded to the payload size.
+     */
+    std::string_view stampedPayload(Session &s) {
+        stamped.clear();
+        appendLatencyStamp(stamped, s.nextSeq++, monotonicNanos());
+        stamped.push_back(' ');
+        if (stamped.size() < payload.size()) {
+            stamped.append(payload, stamped.size(), std::string::npos);
+        } else {
+            stamped.push_back('\n');
+        }
+        return stamped;
+    }
+
+    /**
+     * @return false if the session was closed.
+     */
+    bool handleLine(Session &s, std::string_view line) {
+        if (line.empty()) return true;
+        if (s.state == SessionState::LoggingIn) {
+            if (line.substr(0, 8) == "LOGIN_OK") {
+                if (cfg.binary && acceptsBinaryFrames(line)) {
+                    s.frames.reset(new FrameDecoder(512));
+                } else if (cfg.binary) {
+                    ++stats.binaryRefused; // Server without frame support
+                }
+                s.state = SessionState::Active;
+                s.activeIndex = active.size();
+                active.push_back(&s);
+                if (s.talker) {
+                    s.talkerIndex = talking.size();
+                    talking.push_back(&s);
+                }
+                ++stats.logins;
+                loginLatencies.record(monotonicNanos() - s.connectNs);
+                if (stats.logins == (uint64_t)cfg.sessions) {
+                    allLoggedInAt = std::chrono::duration<double>(Clock::now() - start).count();
+                }
+            } else if (line.substr(0, 5) == "ERROR") {
+                ++stats.loginFailures;
+                closeSession(s);
+                return false;
+            }
+            return true;
+        }
+        // Replayed scrollback is old traffic: keep it out of rates and latency
+        if (s.historyLeft > 0) {
+            --s.historyLeft;
+            ++stats.historyLines;
+            return true;
+        }
+        if (parseHistoryHeader(line, s.historyLeft)) return true;
+        ++stats.linesReceived;
+
+        std::string_view sender;
+        uint64_t seq, sendNs;
+        if (cfg.latency && parseLatencyLine(line, sender, seq, sendNs)) {
+            uint64_t now = monotonicNanos();
+            latencies.record(now > sendNs ? now - sendNs : 0);
+            if (s.sequences) s.sequences->observe(sender, seq);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Queues one "\n"-terminated message in the session's framing.
+     */
+    void queueMessage(Session &s, std::string_view line) {
+        if (!s.frames) {
+            queueSend(s, line);
+            return;
+        }
+        framed.clear();
+        line.remove_suffix(1); // Frames carry the length instead of "\n"
+        appendFrame(framed, FRAME_TEXT, ++s.framesSent, line);
+        queueSend(s, framed);
+    }
+
+    /**
+     * @brief Sends immediately when nothing is queued, otherwise appends.
+     */
+    void queueSend(Session &s, std::string_view data) {
+        stats.bytesSent += data.size();
+        if (s.outOff == s.outBuf.size() && s.state != SessionState::Connecting) {
+            s.outBuf.clear();
+            s.outOff = 0;
+            ssize_t n = send(s.fd, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n == (ssize_t)data.size()) return;
+            if (n < 0) n = 0; // EAGAIN, or an error that the next event reports
+            data.remove_prefix(n);
+        }
+        s.outBuf.append(data);
+    }
+
+    void flushOutput(Session &s) {
+        while (s.outOff < s.outBuf.size()) {
+            ssize_t n = send(s.fd, s.outBuf.data() + s.outOff, s.outBuf.size() - s.outOff,
+                             MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) {
+                s.outOff += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return;
+            }
+        }
+        s.outBuf.clear();
+        s.outOff = 0;
+    }
+
+    void deactivate(Session &s) {
+        if (s.state != SessionState::Active) return;
+        Session *last = active.back();
+        active[s.activeIndex] = last;
+        last->activeIndex = s.activeIndex;
+        active.pop_back();
+        if (s.talker) {
+            last = talking.back();
+            talking[s.talkerIndex] = last;
+            last->talkerIndex = s.talkerIndex;
+            talking.pop_back();
+        }
+    }
+
+    void closeSession(Session &s) {
+        deactivate(s);
+        if (s.sequences) {
+            lostMessages += s.sequences->lost();
+            reorderedMessages += s.sequences->reordered();
+        }
+        int fd = s.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        if (s.talker) --liveTalkers;
+        sessions[fd].reset();
+        --live;
+    }
+
+    /**
+     * @brief Prints one progress line with per-second rates for the interval.
+     */
+    void report(Clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        double dt = std::chrono::duration<double>(now - (lastReportTime == Clock::time_point{} ? start : lastReportTime)).count();
+        if (dt <= 0) dt = 1;
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "[" << elapsed << "s] active=" << active.size()
+                  << " pending=" << (live - active.size())
+                  << " sent/s=" << (stats.messagesSent - lastReported.messagesSent) / dt
+                  << " recv/s=" << (stats.linesReceived - lastReported.linesReceived) / dt
+                  << " in=" << (stats.bytesReceived - lastReported.bytesReceived) / dt / 1024 << "KiB/s"
+                  << " out=" << (stats.bytesSent - lastReported.bytesSent) / dt / 1024 << "KiB/s"
+                  << " connFail=" << stats.connectFailures
+                  << " loginFail=" << stats.loginFailures
+                  << " dropped=" << stats.disconnects
+                  << " stalls=" << stats.sendStalls
+                  << std::endl;
+
+        lastReported = stats;
+        lastReportTime = now;
+    }
+
+    /**
+     * @brief Prints totals and whole-run averages.
+     */
+    void summary(Clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        if (elapsed <= 0) elapsed = 1;
+        uint64_t lost = lostMessages, reordered = reorderedMessages;
+        for (auto &s : sessions) {
+            if (s && s->sequences) {
+                lost += s->sequences->lost();
+                reordered += s->sequences->reordered();
+            }
+        }
+        if (cfg.json) {
+            summaryJson(elapsed, lost, reordered);
+            return;
+        }
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "\n=== chat_loadgen summary (" << elapsed << "s) ===\n"
+                  << "connect attempts:   " << stats.connectAttempts << "\n"
+                  << "connect failures:   " << stats.connectFailures << "\n"
+                  << "login failures:     " << stats.loginFailures << "\n"
+                  << "unexpected drops:   " << stats.disconnects << "\n"
+                  << "logins:             " << stats.logins << "\n";
+        if (cfg.binary) std::cout << "binary refused:     " << stats.binaryRefused << "\n";
+        std::cout << "churn leaves:       " << stats.leaves << "\n"
+                  << "messages sent:      " << stats.messagesSent
+                  << " (" << stats.messagesSent / elapsed << "/s)\n"
+                  << "lines received:     " << stats.linesReceived
+                  << " (" << stats.linesReceived / elapsed << "/s)\n"
+                  << "history replayed:   " << stats.historyLines << "\n"
+                  << "bytes sent:         " << stats.bytesSent << "\n"
+                  << "bytes received:     " << stats.bytesReceived << "\n"
+                  << "send stalls:        " << stats.sendStalls << "\n"
+                  << "active at end:      " << active.size() << "\n"
+                  << "login latency (ms): p50=" << loginLatencies.percentile(0.50) / 1e6
+                  << " p99=" << loginLatencies.percentile(0.99) / 1e6
+                  << " max=" << loginLatencies.max() / 1e6 << "\n"
+                  << "all logged in:      ";
+        if (allLoggedInAt > 0) std::cout << std::setprecision(2) << allLoggedInAt << "s\n" << std::setprecision(1);
+        else std::cout << "never\n";
+        std::cout << std::flush;
+
+        if (cfg.latency) printLatencyReport(std::cout, latencies, lost, reordered);
+    }
+
+    /**
+     * @brief The summary as one JSON object on one line; times in µs, rates per second.
+     */
+    void summaryJson(double elapsed, uint64_t lost, uint64_t reordered) {
+        auto us = [](uint64_t ns) { return ns / 1000.0; };
+        std::cout << std::fixed << std::setprecision(1)
+                  << "{\"elapsed_s\":" << elapsed
+                  << ",\"sessions\":" << cfg.sessions
+                  << ",\"connect_failures\":" << stats.connectFailures
+                  << ",\"login_failures\":" << stats.loginFailures
+                  << ",\"drops\":" << stats.disconnects
+                  << ",\"logins\":" << stats.logins
+                  << ",\"active_at_end\":" << active.size()
+                  << ",\"all_logged_in_s\":" << allLoggedInAt
+                  << ",\"login_p50_us\":" << us(loginLatencies.percentile(0.50))
+                  << ",\"login_p99_us\":" << us(loginLatencies.percentile(0.99))
+                  << ",\"login_max_us\":" << us(loginLatencies.max())
+                  << ",\"messages_sent\":" << stats.messagesSent
+                  << ",\"sent_per_s\":" << stats.messagesSent / elapsed
+                  << ",\"lines_received\":" << stats.linesReceived
+                  << ",\"received_per_s\":" << stats.linesReceived / elapsed
+                  << ",\"bytes_sent\":" << stats.bytesSent
+                  << ",\"bytes_received\":" << stats.bytesReceived
+                  << ",\"send_stalls\":" << stats.sendStalls
+                  << ",\"latency_samples\":" << latencies.count()
+                  << ",\"latency_p50_us\":" << us(latencies.percentile(0.50))
+                  << ",\"latency_p99_us\":" << us(latencies.percentile(0.99))
+                  << ",\"latency_p999_us\":" << us(latencies.percentile(0.999))
+                  << ",\"latency_max_us\":" << us(latencies.max())
+                  << ",\"lost\":" << lost
+                  << ",\"reordered\":" << reordered << "}" << std::endl;
+    }
+};
+
+/**
+ * @brief Raises the open-file limit so thousands of sessions fit.
+ */
+void raiseFileLimit() {
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+void printUsage(const char *prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --host ADDR       Server host name or address (default 127.0.0.1)\n"
+              << "  --port N          Server port (default 4000)\n"
+              << "  --unix PATH       Connect to the server's Unix socket instead (\"@name\": abstract)\n"
+              << "  --sessions N      Concurrent sessions to open (default 1000)\n"
+              << "  --ramp N          New sessions per second during ramp-up (default: all at once)\n"
+              << "  --rate R          Messages per second per session (default 1)\n"
+              << "  --payload N       Message size in bytes (default 32)\n"
+              << "  --churn R         Leave+rejoin cycles per second (default 0)\n"
+              << "  --duration S      Run time in seconds, 0 = until Ctrl-C (default 30)\n"
+              << "  --interval S      Seconds between progress reports (default 1)\n"
+              << "  --prefix NAME     Username prefix (default \"load\")\n"
+              << "  --latency         Stamp messages and report delivery latency percentiles\n"
+              << "  --probes N        Sessions that count loss/reordering in latency mode (default 16)\n"
+              << "  --binary          Negotiate length-prefixed binary frames at LOGIN\n"
+              << "  --talkers N       Only the first N sessions send; the rest listen (default: all)\n"
+              << "  --json            Print the summary as one JSON object, without progress lines\n";
+}
+
+/**
+ * @brief Entry point: parses options and runs the workload.
+ * @return int Exit status (0 for success, non-zero for error).
+ */
+int main(int argc, char **argv) {
+    LoadConfig cfg;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--latency") {
+            cfg.latency = true;
+            continue;
+        }
+        if (arg == "--binary") {
+            cfg.binary = true;
+            continue;
+        }
+        if (arg == "--json") {
+            cfg.json = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            printUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--host") cfg.host = value;
+            else if (arg == "--port") cfg.port = std::stoi(value);
+            else if (arg == "--unix") cfg.unixPath = value;
+            else if (arg == "--sessions") cfg.sessions = std::stoi(value);
+            else if (arg == "--ramp") cfg.rampRate = std::stod(value);
+            else if (arg == "--rate") cfg.messageRate = std::stod(value);
+            else if (arg == "--payload") cfg.payloadSize = std::stoul(value);
+            else if (arg == "--churn") cfg.churnRate = std::stod(value);
+            else if (arg == "--duration") cfg.duration = std::stod(value);
+            else if (arg == "--interval") cfg.reportInterval = std::stod(value);
+            else if (arg == "--prefix") cfg.prefix = value;
+            else if (arg == "--probes") cfg.probes = std::stoi(value);
+            else if (arg == "--talkers") cfg.talkers = std::stoi(value);
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception &) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+    }
+    if (cfg.reportInterval <= 0) cfg.reportInterval = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    raiseFileLimit();
+
+    if (!cfg.json) std::cout << "chat_loadgen: " << cfg.sessions << " sessions -> "
+              << (cfg.unixPath.empty() ? cfg.host + ":" + std::to_string(cfg.port) : "unix:" + cfg.unixPath)
+              << ", " << cfg.messageRate << " msg/s each, " << cfg.payloadSize << "-byte payloads"
+              << (cfg.binary ? ", binary frames" : "") << std::endl;
+
+    LoadGenerator gen(cfg);
+    return gen.run() ? 0 : 1;
+}
@@ -0,0 +1,434 @@
+/**
+ * @file chat_microbench.cpp
+ * @brief Microbenchmarks for the per-message hot paths of the client and server.
+ *
+ * Every benchmark runs one operation in a tight loop, long enough to be
+ * timed reliably (--min-time), a few times over (--repetitions), and
+ * reports the median time per iteration:
+ * 1. line_framer/<n>B: 64 KiB recv() buffers of n-byte lines through LineFramer.
+ * 2. frame_decoder/<n>B: the same stream as binary frames through FrameDecoder.
+ * 3. timestamp/min|sec|ms: the client's getTimestamp() (formatTimestamp()).
+ * 4. classify_line: the client's "SERVER:" / "WHISPER " display decision.
+ * 5. format_chat_line/<n>B: the server's "<username>: <text>" line.
+ * 6. fanout/<n>: one broadcast buffer queued to n in-memory output queues,
+ *    then drained, as deliver() and the following sends do.
+ * 7. deflate/<msg>, inflate/<msg>: "+z" compression of one message.
+ *
+ * Results are printed as a table. --json FILE also writes them in the JSON
+ * layout of Google Benchmark, so its tools (compare.py) can read them.
+ * --baseline FILE compares the run with an earlier --json file and exits
+ * with status 2 if any benchmark got slower by more than --max-regression
+ * percent, which makes the program usable as a pre-deploy check.
+ */
+
+#include <iostream>
+#include <iomanip>     // For the table columns
+#include <fstream>     // For --json / --baseline files
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>         // For baseline results by name
+#include <memory>
+#include <functional>  // For the benchmark bodies
+#include <algorithm>   // For std::sort (median)
+#include <chrono>
+#include <ctime>       // For clock_gettime(CLOCK_PROCESS_CPUTIME_ID)
+#include <thread>      // For hardware_concurrency()
+#include <unistd.h>    // For gethostname()
+#include "line_framer.hpp"
+#include "binary_frame.hpp"
+#include "timestamp_cache.hpp"
+#include "terminal_renderer.hpp"
+#include "chat_rooms.hpp"
+#include "output_queue.hpp"
+#include "message_compression.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Size of one simulated recv() in the framing benchmarks (the server's READ_CHUNK)
+constexpr size_t RECV_CHUNK = 64 * 1024;
+
+/**
+ * @brief Keeps the compiler from optimizing a result away.
+ */
+template <typename T>
+inline void keep(const T &value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+/**
+ * @brief One benchmark: body(n) performs the operation n times.
+ */
+struct Benchmark {
+    std::string name;
+    size_t bytes = 0; // Bytes processed per operation (0 = not reported)
+    size_t items = 0; // Messages handled per operation (0 = not reported)
+    std::function<void(uint64_t)> body;
+};
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double realNs = 0; // Per operation, median of the repetitions
+    double cpuNs = 0;  // Process CPU time of that same repetition
+    double bytesPerSecond = 0;
+    double itemsPerSecond = 0;
+};
+
+struct BenchConfig {
+    double minTime = 0.1;   // Seconds per repetition
+    int repetitions = 3;
+    std::string filter;     // Substring of the benchmark names to run
+    std::string jsonPath;   // Also write JSON here ("-" = stdout)
+    std::string baseline;   // Earlier --json output to compare against
+    double maxRegression = 10; // Percent slower than the baseline that fails
+};
+
+static double cpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Times b: grows the iteration count until one run takes about
+ * minTime, then keeps the median of the repetitions.
+ */
+BenchResult measure(const Benchmark &b, const BenchConfig &cfg) {
+    auto timed = [&](uint64_t n, double &cpu) {
+        double cpuStart = cpuSeconds();
+        auto start = Clock::now();
+        b.body(n);
+        double real = std::chrono::duration<double>(Clock::now() - start).count();
+        cpu = cpuSeconds() - cpuStart;
+        return real;
+    };
+
+    uint64_t n = 1;
+    double cpu;
+    while (true) {
+        double real = timed(n, cpu);
+        if (real >= cfg.minTime || n >= (1ull << 40)) break;
+        // Aim a little past minTime; at most 10x per step while runs are tiny
+        double scale = real > 0 ? cfg.minTime * 1.2 / real : 10;
+        n = (uint64_t)(n * std::min(std::max(scale, 1.5), 10.0)) + 1;
+    }
+
+    std::vector<std::pair<double, double>> runs; // (real, cpu) per repetition
+    for (int r = 0; r < cfg.repetitions; ++r) {
+        double real = timed(n, cpu);
+        runs.emplace_back(real, cpu);
+    }
+    std::sort(runs.begin(), runs.end());
+    auto [real, cpuTime] = runs[runs.size() / 2];
+
+    BenchResult result;
+    result.name = b.name;
+    result.iterations = n;
+    result.realNs = real * 1e9 / n;
+    result.cpuNs = cpuTime * 1e9 / n;
+    if (b.bytes) result.bytesPerSecond = b.bytes * n / real;
+    if (b.items) result.itemsPerSecond = b.items * n / real;
+    return result;
+}
+
+// ====== BENCHMARKS ======
+
+/**
+ * @brief A stream of n-byte lines ("<user>: xxx...\n"), cut into RECV_CHUNK
+ * pieces like recv() would; the last line of a piece continues in the next.
+ */
+std::string lineStream(size_t lineBytes) {
+    std::string line = formatChatLine("alice", std::string(lineBytes - 8, 'x'));
+    line.push_back('\n');
+    std::string stream;
+    while (stream.size() < RECV_CHUNK) stream += line;
+    stream.resize(RECV_CHUNK);
+    return stream;
+}
+
+void addFramingBenchmarks(std::vector<Benchmark> &out) {
+    for (size_t size : {32, 128, 1024}) {
+        auto chunk = std::make_shared<std::string>(lineStream(size));
+        auto framer = std::make_shared<LineFramer>(RECV_CHUNK);
+        out.push_back({"line_framer/" + std::to_string(size) + "B", RECV_CHUNK, RECV_CHUNK / size,
+                       [chunk, framer](uint64_t n) {
+                           std::string_view line;
+                           for (uint64_t i = 0; i < n; ++i) {
+                               framer->append(chunk->data(), chunk->size());
+                               while (framer->nextLine(line)) keep(line);
+                           }
+                       }});
+    }
+    for (size_t size : {32, 128, 1024}) {
+        auto chunk = std::make_shared<std::string>();
+        std::string text(size - FRAME_HEADER_SIZE, 'x');
+        while (chunk->size() < RECV_CHUNK) appendFrame(*chunk, FRAME_TEXT, 1, text);
+        chunk->resize(RECV_CHUNK);
+        auto decoder = std::make_shared<FrameDecoder>(RECV_CHUNK);
+        out.push_back({"frame_decoder/" + std::to_string(size) + "B", RECV_CHUNK, RECV_CHUNK / size,
+                       [chunk, decoder](uint64_t n) {
+                           FrameHeader header;
+                           std::string_view payload;
+                           for (uint64_t i = 0; i < n; ++i) {
+                               decoder->append(chunk->data(), chunk->size());
+                               while (decoder->next(header, payload) == FrameDecoder::Result::Frame) keep(payload);
+                           }
+                       }});
+    }
+}
+
+void addFormattingBenchmarks(std::vector<Benchmark> &out) {
+    const std::pair<const char *, TimestampFormat> formats[] = {
+        {"min", TimestampFormat::Minutes}, {"sec", TimestampFormat::Seconds},
+        {"ms", TimestampFormat::Milliseconds}};
+    for (const auto &[name, format] : formats) {
+        TimestampFormat f = format;
+        out.push_back({std::string("timestamp/") + name, 0, 1, [f](uint64_t n) {
+                           for (uint64_t i = 0; i < n; ++i) keep(formatTimestamp(f));
+                       }});
+    }
+
+    // What a busy room shows: mostly chat, some notices and whispers
+    auto lines = std::make_shared<std::vector<std::string>>(std::vector<std::string>{
+        "alice: hello everyone", "SERVER: bob has joined the chat", "bob: hi alice",
+        "carol: how is it going?", "WHISPER from dave: psst", "alice: fine, thanks",
+        "SERVER: carol has left #lobby", "bob: see you"});
+    out.push_back({"classify_line", 0, 1, [lines](uint64_t n) {
+                       for (uint64_t i = 0; i < n; ++i) keep(classifyLine((*lines)[i & 7]));
+                   }});
+
+    for (size_t size : {16, 256}) {
+        auto text = std::make_shared<std::string>(size, 'x');
+        out.push_back({"format_chat_line/" + std::to_string(size) + "B", 0, 1, [text](uint64_t n) {
+                           for (uint64_t i = 0; i < n; ++i) {
+                               std::string line = formatChatLine("alice", *text);
+                               keep(line);
+                           }
+                       }});
+    }
+}
+
+void addFanoutBenchmarks(std::vector<Benchmark> &out) {
+    for (size_t members : {1, 100, 10000}) {
+        auto queues = std::make_shared<std::vector<OutputQueue>>(members);
+        auto message = std::make_shared<std::string>(formatChatLine("alice", std::string(48, 'x')) + "\n");
+        out.push_back({"fanout/" + std::to_string(members), 0, members, [queues, message](uint64_t n) {
+                           for (uint64_t i = 0; i < n; ++i) {
+                               SharedBuffer line = makeSharedBuffer(*message);
+                               for (OutputQueue &q : *queues) q.enqueue(line);
+                               for (OutputQueue &q : *queues) q.consume(q.bytesQueued());
+                           }
+                       }});
+    }
+}
+
+void addCompressionBenchmarks(std::vector<Benchmark> &out) {
+    const std::pair<const char *, const char *> messages[] = {
+        {"notice", "SERVER: alice has joined the chat"},
+        {"chat", "alice: is anyone around who could help me with the deploy this morning? thanks"}};
+    for (const auto &[name, text] : messages) {
+        auto plain = std::make_shared<std::string>(text);
+        auto compressor = std::make_shared<MessageCompressor>();
+        auto packed = std::make_shared<std::string>();
+        compressor->compress(*plain, *packed);
+        out.push_back({std::string("deflate/") + name, plain->size(), 1, [plain, compressor](uint64_t n) {
+                           std::string result;
+                           for (uint64_t i = 0; i < n; ++i) {
+                               compressor->compress(*plain, result);
+                               keep(result);
+                           }
+                       }});
+        auto decompressor = std::make_shared<MessageDecompressor>();
+        out.push_back({std::string("inflate/") + name, plain->size(), 1, [packed, decompressor](uint64_t n) {
+                           std::string result;
+                           for (uint64_t i = 0; i < n; ++i) {
+                               decompressor->decompress(*packed, result);
+                               keep(result);
+                           }
+                       }});
+    }
+}
+
+// ====== REPORTING ======
+
+void printTable(const std::vector<BenchResult> &results) {
+    std::cout << std::left << std::setw(26) << "Benchmark" << std::right << std::setw(14) << "Time (ns)"
+              << std::setw(14) << "CPU (ns)" << std::setw(14) << "Iterations" << "  Throughput\n";
+    for (const BenchResult &r : results) {
+        std::cout << std::left << std::setw(26) << r.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << r.realNs << std::setw(14) << r.cpuNs << std::setw(14) << r.iterations;
+        if (r.bytesPerSecond) std::cout << "  " << std::setprecision(0) << r.bytesPerSecond / 1e6 << " MB/s";
+        if (r.itemsPerSecond) std::cout << "  " << std::setprecision(2) << r.itemsPerSecond / 1e6 << " M msg/s";
+        std::cout << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Writes results in the layout of Google Benchmark's --benchmark_format=json.
+ */
+void writeJson(std::ostream &os, const std::vector<BenchResult> &results, const BenchConfig &cfg) {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    os << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << date << "\",\n"
+       << "    \"host_name\": \"" << host << "\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+       << "    \"compiler\": \"" << __VERSION__ << "\",\n"
+#ifdef __OPTIMIZE__
+       << "    \"optimized\": true,\n"
+#else
+       << "    \"optimized\": false,\n"
+#endif
+       << "    \"min_time\": " << cfg.minTime << ",\n"
+       << "    \"repetitions\": " << cfg.repetitions << "\n"
+       << "  },\n  \"benchmarks\": [\n";
+    os << std::setprecision(6);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        // One benchmark per line, which --baseline relies on
+        os << "    {\"name\": \"" << r.name << "\", \"run_name\": \"" << r.name
+           << "\", \"run_type\": \"iteration\", \"iterations\": " << r.iterations
+           << ", \"real_time\": " << r.realNs << ", \"cpu_time\": " << r.cpuNs << ", \"time_unit\": \"ns\"";
+        if (r.bytesPerSecond) os << ", \"bytes_per_second\": " << r.bytesPerSecond;
+        if (r.itemsPerSecond) os << ", \"items_per_second\": " << r.itemsPerSecond;
+        os << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+/**
+ * @brief Reads name -> real_time from a file written by writeJson().
+ */
+bool readBaseline(const std::string &path, std::map<std::string, double> &out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t time = line.find("\"real_time\": ");
+        if (name == std::string::npos || time == std::string::npos) continue;
+        name += 9;
+        out[line.substr(name, line.find('"', name) - name)] = std::stod(line.substr(time + 13));
+    }
+    return true;
+}
+
+/**
+ * @brief Prints the change against the baseline for every benchmark in both.
+ * @return false if any got slower than allowed.
+ */
+bool compareWithBaseline(std::ostream &os, const std::vector<BenchResult> &results,
+                         const std::map<std::string, double> &baseline, double maxRegression) {
+    bool ok = true;
+    os << "\nCompared with the baseline (real time, +" << maxRegression << "% allowed):\n";
+    for (const BenchResult &r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) continue;
+        double change = (r.realNs / it->second - 1) * 100;
+        bool regressed = change > maxRegression;
+        ok = ok && !regressed;
+        os << std::left << std::setw(26) << r.name << std::right << std::fixed << std::setprecision(1)
+           << std::setw(12) << it->second << " -> " << std::setw(12) << r.realNs << " ns  "
+           << std::showpos << std::setw(7) << change << "%" << std::noshowpos
+           << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    return ok;
+}
+
+void printUsage(const char *prog) {
+    std::cerr << "Usage: " << prog << " [options]\n"
+              << "  --filter TEXT          Only run benchmarks whose name contains TEXT\n"
+              << "  --min-time S           Seconds per timed repetition (default 0.1)\n"
+              << "  --repetitions N        Repetitions per benchmark; the median is reported (default 3)\n"
+              << "  --json FILE            Also write the results as JSON (\"-\" = stdout)\n"
+              << "  --baseline FILE        Compare with an earlier --json file\n"
+              << "  --max-regression PCT   Allowed slowdown against the baseline (default 10)\n"
+              << "  --list                 Print the benchmark names and exit\n";
+}
+
+/**
+ * @brief Entry point: runs the selected benchmarks and reports them.
+ * @return int 0 on success, 1 on bad arguments, 2 if a benchmark regressed.
+ */
+int main(int argc, char **argv) {
+    BenchConfig cfg;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            list = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            printUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--filter") cfg.filter = value;
+            else if (arg == "--min-time") cfg.minTime = std::stod(value);
+            else if (arg == "--repetitions") cfg.repetitions = std::max(1, std::stoi(value));
+            else if (arg == "--json") cfg.jsonPath = value;
+            else if (arg == "--baseline") cfg.baseline = value;
+            else if (arg == "--max-regression") cfg.maxRegression = std::stod(value);
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception &) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!cfg.baseline.empty() && !readBaseline(cfg.baseline, baseline)) {
+        std::cerr << "Cannot read baseline " << cfg.baseline << std::endl;
+        return 1;
+    }
+
+    std::vector<Benchmark> benchmarks;
+    addFramingBenchmarks(benchmarks);
+    addFormattingBenchmarks(benchmarks);
+    addFanoutBenchmarks(benchmarks);
+    addCompressionBenchmarks(benchmarks);
+
+    std::vector<BenchResult> results;
+    for (const Benchmark &b : benchmarks) {
+        if (b.name.find(cfg.filter) == std::string::npos) continue;
+        if (list) {
+            std::cout << b.name << "\n";
+            continue;
+        }
+        results.push_back(measure(b, cfg));
+        // Progress on stderr, so "--json -" output stays clean
+        std::cerr << "." << std::flush;
+    }
+    if (list) return 0;
+    std::cerr << std::endl;
+
+    if (cfg.jsonPath == "-") {
+        writeJson(std::cout, results, cfg);
+    } else {
+        printTable(results);
+        if (!cfg.jsonPath.empty()) {
+            std::ofstream json(cfg.jsonPath);
+            writeJson(json, results, cfg);
+            if (!json) {
+                std::cerr << "Cannot write " << cfg.jsonPath << std::endl;
+                return 1;
+            }
+        }
+    }
+    std::ostream &report = cfg.jsonPath == "-" ? std::cerr : std::cout;
+    if (!baseline.empty() && !compareWithBaseline(report, results, baseline, cfg.maxRegression)) return 2;
+    return 0;
+}
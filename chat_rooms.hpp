@@ -0,0 +1,65 @@
+/**
+ * @file chat_rooms.hpp
+ * @brief Room names and room commands shared by the server and the client.
+ *
+ * Every user starts in DEFAULT_ROOM and is always in exactly one room;
+ * messages and join/leave notices only reach the members of that room.
+ *
+ *     "/join <room>"  answered with "JOIN_OK <room>" (switches rooms)
+ *     "/part"         answered with "PART_OK <room>" (back to DEFAULT_ROOM)
+ *
+ * Invalid requests are answered with "ERROR ...". Members of the rooms
+ * involved see "SERVER: <username> has left #<old>" and
+ * "SERVER: <username> has joined #<new>".
+ *
+ * LOGIN_OK and JOIN_OK may be followed by the room's recent messages
+ * (scrollback): a "HISTORY <n>" line, then n earlier chat lines, oldest first.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+constexpr std::string_view DEFAULT_ROOM = "lobby";
+constexpr size_t MAX_ROOM_NAME = 32;
+
+/**
+ * @brief Room names are 1..MAX_ROOM_NAME letters, digits, '-' or '_'.
+ */
+inline bool isValidRoomName(std::string_view name) {
+    if (name.empty() || name.size() > MAX_ROOM_NAME) return false;
+    for (char ch : name) {
+        bool ok = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+                  (ch >= '0' && ch <= '9') || ch == '-' || ch == '_';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief The line a chat message is relayed as: "<username>: <text>".
+ * Sized up front, so building it is a single allocation.
+ */
+inline std::string formatChatLine(std::string_view username, std::string_view text) {
+    std::string line;
+    line.reserve(username.size() + 2 + text.size());
+    line.append(username).append(": ").append(text);
+    return line;
+}
+
+/**
+ * @brief Parses a "HISTORY <n>" scrollback header.
+ * @return false if line is something else.
+ */
+inline bool parseHistoryHeader(std::string_view line, size_t &count) {
+    constexpr std::string_view prefix = "HISTORY ";
+    if (line.substr(0, prefix.size()) != prefix || line.size() == prefix.size()) return false;
+    count = 0;
+    for (char ch : line.substr(prefix.size())) {
+        if (ch < '0' || ch > '9') return false;
+        count = count * 10 + (size_t)(ch - '0');
+    }
+    return true;
+}
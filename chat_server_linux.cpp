@@ -0,0 +1,1724 @@
+/**
+ * @file chat_server_linux.cpp
+ * @brief Native Linux TCP chat server built on edge-triggered epoll.
+ *
+ * This server is a drop-in replacement for the TCP half of backend/server.js.
+ * It speaks exactly the same line protocol, so the existing C++ clients work
+ * against it unchanged:
+ * 1. "WELCOME: ..." greeting on connect.
+ * 2. "LOGIN <username>" answered with "LOGIN_OK Welcome, <username>" or "ERROR ...",
+ *    followed by "HISTORY <n>" and the room's last n messages (--scrollback).
+ * 3. "SERVER: <username> has joined/left the chat" notifications.
+ * 4. "<username>: <text>" broadcasts to every other user in the sender's room.
+ * 5. "/quit" answered with "BYE" before the connection is closed.
+ * 6. "/join <room>" and "/part" to switch rooms (see chat_rooms.hpp).
+ * 7. "/msg <user> <text>" delivered as "WHISPER from <sender>: <text>" to that
+ *    user only and echoed as "WHISPER to <user>: <text>"; names containing
+ *    spaces are quoted ("/msg \"alice smith\" hi").
+ *
+ * Clients that log in with "LOGIN <username> +bin" switch to the
+ * length-prefixed frames described in binary_frame.hpp after LOGIN_OK;
+ * text and binary clients can chat with each other. "+seq=<n>" and
+ * "+room=<room>" (session_resume.hpp) number text broadcasts and let a
+ * reconnecting client replay only the scrollback it missed. Frame clients
+ * that add "+z" get broadcasts deflated against a preset dictionary
+ * (message_compression.hpp); each broadcast is compressed once, by the
+ * reactor it starts on, and the frame is shared by every "+z" recipient.
+ *
+ * Each reactor runs on one thread: sockets are non-blocking, registered once
+ * with EPOLLET, and drained until EAGAIN on every readiness edge. By default
+ * there is a single reactor. With --reactors N, every reactor has its own
+ * SO_REUSEPORT listener (the kernel spreads new connections across them),
+ * epoll instance and sessions, pinned to its own core. A broadcast is
+ * delivered locally and handed to every other reactor through a lock-free
+ * queue (mpsc_queue.hpp); no lock is taken on the message path.
+ *
+ * With --io-uring, each reactor drives its sockets through io_uring
+ * (uring.hpp) instead of epoll: one multishot recv per connection fills
+ * buffers from a shared provided-buffer ring, and the sends queued while
+ * handling a batch of completions go to the kernel together with the next
+ * wait, in one io_uring_enter() call. A broadcast to N members therefore
+ * costs no per-member syscall.
+ *
+ * Room membership is sharded the same way: each reactor keeps, per room, a
+ * flat array of its own members, so delivering a message walks only the
+ * room's local sockets and joins/leaves are O(1) swap-removals. Direct
+ * messages find their recipient through a server-wide username index
+ * (user_index.hpp) and go straight to the owning reactor's inbox. Every
+ * reactor also remembers the last --scrollback chat messages of each room
+ * (scrollback_ring.hpp), in sequence order, for up to MAX_SCROLLBACK_ROOMS
+ * recently active rooms, and replays them, in the same write as LOGIN_OK or
+ * JOIN_OK, to whoever enters the room.
+ *
+ * With --log-dir, every chat message is also appended to a durable,
+ * segmented message log (message_log.hpp). A writer thread copies the
+ * records into memory-mapped segments and syncs them in groups, so the
+ * reactors never make a disk syscall.
+ *
+ * Output queues are bounded: once a client has --high-water bytes queued,
+ * further broadcasts to it are dropped, coalesced into one "skipped" notice,
+ * or the client is disconnected (--slow-policy), until it drains below
+ * --low-water. A stalled reader therefore cannot grow server memory.
+ *
+ * With --metrics-port, GET /metrics on that port returns Prometheus-style
+ * counters (server_metrics.hpp). Each reactor counts into its own shard;
+ * a scrape sums them on the metrics thread.
+ *
+ * With --unix PATH the server also accepts same-host clients on a Unix
+ * domain socket (unix_socket.hpp; "@name" for the abstract namespace),
+ * speaking the same protocol without the TCP loopback overhead. There is
+ * one such listener, shared by every reactor (EPOLLEXCLUSIVE, so a new
+ * connection wakes only one of them).
+ */
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map> // For the room table
+#include <memory>      // For std::unique_ptr (per-connection state)
+#include <atomic>      // For the cross-reactor sequence counter and wake flag
+#include <mutex>       // For serializing log lines from reactor threads
+#include <sstream>     // For assembling log lines
+#include <thread>      // For one thread per reactor
+#include <chrono>      // For timing broadcast fan-out
+#include <cstring>     // For strerror()
+#include <cerrno>      // For errno / EAGAIN
+#include <csignal>     // For ignoring SIGPIPE
+#include <unistd.h>    // For close()
+#include <cctype>     // For tolower()
+#include <arpa/inet.h> // For htons() / htonl()
+#include <netinet/in.h>   // For sockaddr_in
+#include <netinet/tcp.h>  // For TCP_NODELAY
+#include <sys/socket.h>   // For socket(), bind(), listen(), accept4(), send(), recv()
+#include <sys/stat.h>     // For replacing a stale --unix socket file
+#include <sys/epoll.h>    // For epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/resource.h> // For raising RLIMIT_NOFILE
+#include <sys/eventfd.h>  // For waking a reactor when broadcasts are queued for it
+#include <poll.h>         // For POLLIN (--io-uring wake-ups)
+#include <pthread.h>      // For pinning reactor threads to cores
+#include <sched.h>        // For cpu_set_t
+#include "line_framer.hpp"    // For splitting received bytes into lines
+#include "binary_frame.hpp"   // For clients that negotiated "+bin"
+#include "session_resume.hpp" // For "+seq=<n>" / "+room=<room>" at LOGIN
+#include "output_queue.hpp"   // For shared, reference-counted output buffers
+#include "mpsc_queue.hpp"     // For cross-reactor broadcast hand-off
+#include "chat_rooms.hpp"     // For room names and /join, /part
+#include "user_index.hpp"     // For /msg recipient lookup
+#include "message_log.hpp"    // For the persistent message log (--log-dir)
+#include "scrollback_ring.hpp" // For replaying recent messages on LOGIN / join
+#include "uring.hpp"          // For the --io-uring backend
+#include "message_compression.hpp" // For "+z" (deflated broadcast frames)
+#include "server_metrics.hpp"     // For the /metrics endpoint (--metrics-port)
+#include "unix_socket.hpp"        // For the --unix listener
+
+// Same default as TCP_PORT in backend/server.js
+constexpr int DEFAULT_TCP_PORT = 4000;
+// Maximum number of readiness events handled per epoll_wait() call
+constexpr int MAX_EVENTS = 1024;
+// Minimum free space offered to each recv() while draining a socket
+constexpr size_t READ_CHUNK = 64 * 1024;
+// Rooms whose scrollback each reactor keeps; the least recently written go first
+constexpr size_t MAX_SCROLLBACK_ROOMS = 1024;
+// --log-dir: newest log segments read at startup to rebuild the scrollback
+constexpr size_t SCROLLBACK_RESTORE_BYTES = 256u << 20;
+// --io-uring: submission queue size and the provided receive buffers
+constexpr unsigned URING_ENTRIES = 4096;
+constexpr uint16_t RECV_GROUP = 0;
+constexpr unsigned RECV_BUFFERS = 1024;       // Power of two
+constexpr unsigned RECV_BUFFER_SIZE = 8 * 1024;
+
+/**
+ * @brief What happens to broadcasts for a client above its high watermark.
+ */
+enum class SlowPolicy {
+    Drop,       // Discard them silently
+    Coalesce,   // Discard them, then send one "N messages skipped" notice
+    Disconnect  // Close the connection
+};
+
+/**
+ * @brief Command-line settings.
+ */
+struct ServerOptions {
+    int port = DEFAULT_TCP_PORT;
+    int reactors = 1;               // Event-loop threads (0 = one per core)
+    bool verbose = false;
+    size_t highWater = 256 * 1024;  // Queued bytes at which the policy kicks in
+    size_t lowWater = 64 * 1024;    // Queued bytes at which delivery resumes
+    SlowPolicy slowPolicy = SlowPolicy::Coalesce;
+    std::string logDir;             // Message log directory (empty = no log)
+    size_t logSegmentBytes = 64 << 20; // Preallocated size of each log segment
+    int logSyncMs = 20;             // Group-commit interval of the message log
+    size_t scrollback = 50;         // Chat messages replayed per room (0 = none)
+    bool ioUring = false;           // io_uring instead of epoll
+    int metricsPort = 0;            // HTTP port serving /metrics (0 = none)
+    std::string unixPath;           // Also listen on this Unix socket (empty = no)
+};
+
+std::mutex logMutex;
+
+/**
+ * @brief Writes one log line; reactor threads never interleave mid-line.
+ */
+template <typename... Args>
+void logLine(const Args &...args) {
+    std::ostringstream line;
+    (line << ... << args);
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::cout << line.str() << std::endl;
+}
+
+/**
+ * @brief One broadcast, shared by every reactor that delivers it.
+ * A direct message (/msg) is the same thing addressed to a single session.
+ */
+struct Broadcast {
+    uint64_t seq = 0;       // Server-wide sequence number (frames, "+seq" lines)
+    std::string room;       // Only members of this room receive it
+    std::string text;       // Message without terminator
+    SharedBuffer line;      // text + "\n", sent to every text client
+    int fd = -1;            // Direct message: recipient's socket on its reactor
+    uint64_t recipient = 0; // Direct message: recipient's session id (0 = room)
+    bool chat = false;      // A chat message (kept in the room's scrollback)
+    SharedBuffer deflated;  // Compressed TEXT frame for "+z" peers (null: send plain)
+};
+using BroadcastPtr = std::shared_ptr<const Broadcast>;
+
+class Reactor;
+
+/**
+ * @brief Where a logged-in session lives. The id tells a reused fd apart.
+ */
+struct SessionRef {
+    Reactor *reactor = nullptr;
+    int fd = -1;
+    uint64_t id = 0;
+
+    bool operator==(const SessionRef &o) const { return id == o.id; }
+};
+
+/**
+ * @brief State shared by all reactors.
+ */
+struct ServerShared {
+    std::atomic<uint64_t> broadcastSeq{0};
+    std::atomic<uint64_t> sessionIds{0};
+    std::vector<Reactor*> reactors;
+    UserIndex<SessionRef> users;  // Logged-in sessions by username
+    MessageLog *log = nullptr;    // Set when --log-dir is given
+    // Logged-in "+z" sessions; broadcasts are only compressed while there are any
+    std::atomic<int> compressedSessions{0};
+};
+
+struct Client;
+
+/**
+ * @brief --io-uring: the sendmsg() arguments of a client's send in flight.
+ */
+struct UringSend {
+    msghdr msg{};
+    iovec iov[OutputQueue::MAX_IOV];
+};
+
+/**
+ * @brief One reactor's share of a room: the room's members on that reactor.
+ */
+struct Room {
+    std::string name;
+    std::vector<Client*> members; // Contiguous, so delivery is a linear scan
+};
+
+/**
+ * @brief Per-connection state, mirroring the closure variables of server.js.
+ */
+struct Client {
+    int fd = -1;
+    bool loggedIn = false;
+    bool closing = false;     // Set after /quit: close once out has drained
+    std::string username;
+    uint64_t sessionId = 0;   // Server-wide, assigned at LOGIN
+    OutputQueue out;          // Bytes the kernel did not accept yet (shared buffers)
+    Room *room = nullptr;     // Current room while logged in
+    size_t memberIndex = 0;   // Position in room->members
+    bool congested = false;   // Above the high watermark; broadcasts withheld
+    bool evicted = false;     // Disconnect policy: close after the current event
+    uint64_t skipped = 0;     // Broadcasts withheld during this congestion
+    // Set once the client negotiated binary frames; frames can span reads,
+    // so unlike text lines they need a per-connection reassembly buffer.
+    std::unique_ptr<FrameDecoder> frames;
+    bool numbered = false;    // "+seq": text broadcasts start with "#<seq> "
+    bool compressed = false;  // "+z": broadcasts as deflated frames where that is smaller
+    CompressionStats compression; // "+z": broadcast frames sent to this client
+    // --io-uring: requests the kernel holds for this client. A closed client
+    // stays allocated until both have completed.
+    bool recvArmed = false;   // Multishot recv armed
+    bool sending = false;     // SENDMSG over the front of out in flight
+    bool sendListed = false;  // Waiting in Reactor::pendingSends
+    bool closed = false;
+    std::unique_ptr<UringSend> send;
+    std::string carry;        // Unfinished line while the socket still has more to read
+};
+
+/**
+ * @brief One single-threaded epoll event loop and the sessions it owns.
+ */
+class Reactor {
+public:
+    Reactor(const ServerOptions &options, ServerShared &shared)
+        : opts(options), shared(shared), scrollback(MAX_SCROLLBACK_ROOMS, options.scrollback) {}
+
+    /**
+     * @brief Creates the listening socket, the epoll instance and the wake-up eventfd.
+     * With --io-uring the ring is created later, by run() on the reactor's thread.
+     * @param port TCP port to listen on (all IPv4 interfaces).
+     * @param reusePort Share the port with the other reactors (SO_REUSEPORT).
+     * @return true on success, false if any setup step failed.
+     */
+    bool listenOn(int port, bool reusePort) {
+        // io_uring waits for readiness itself, so its sockets stay blocking
+        int nonBlocking = opts.ioUring ? 0 : SOCK_NONBLOCK;
+        listenFd = socket(AF_INET, SOCK_STREAM | nonBlocking | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            std::cerr << "Error creating socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (reusePort && setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+            std::cerr << "SO_REUSEPORT failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(listenFd, SOMAXCONN) < 0) {
+            std::cerr << "Failed to listen on port " << port << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd < 0) {
+            std::cerr << "Error creating eventfd: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (opts.ioUring) return true;
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            std::cerr << "Error creating epoll instance: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+        ev.events = EPOLLIN;
+        ev.data.fd = wakeFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+        return true;
+    }
+
+    /**
+     * @brief Also accepts connections from the server-wide Unix socket listener.
+     * Call after listenOn(), before run().
+     */
+    void shareUnixListener(int fd) {
+        unixFd = fd;
+        if (opts.ioUring) return; // run() arms a multishot accept on it
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+        ev.data.fd = unixFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, unixFd, &ev);
+    }
+
+    /**
+     * @brief Queues a broadcast from another reactor; callable from any thread.
+     * Only the first post after the reactor last drained its inbox pays for
+     * an eventfd write.
+     */
+    void post(const BroadcastPtr &b) {
+        inbox.push(b);
+        if (!wakePending.exchange(true, std::memory_order_acq_rel)) {
+            uint64_t one = 1;
+            (void)!write(wakeFd, &one, sizeof(one));
+        }
+    }
+
+    /**
+     * @brief Runs the event loop forever.
+     */
+    void run() {
+        if (opts.ioUring) runUring();
+        else runEpoll();
+    }
+
+    /**
+     * @brief Adds a logged chat message to the scrollback; only before run().
+     */
+    void restoreScrollback(const BroadcastPtr &b) {
+        if (opts.scrollback > 0) remember(b);
+    }
+
+    /**
+     * @brief This reactor's counters; safe to read from any thread.
+     */
+    const ServerMetrics &stats() const { return metrics; }
+
+private:
+    const ServerOptions &opts;
+    ServerShared &shared;
+    ServerMetrics metrics; // Written only by this reactor's thread
+    int listenFd = -1;
+    int unixFd = -1;          // Shared with the other reactors (--unix)
+    int epollFd = -1;
+    int wakeFd = -1;
+    // Broadcasts from other reactors, and whether a wake-up is already signalled
+    MpscQueue<BroadcastPtr> inbox;
+    std::atomic<bool> wakePending{false};
+    // Connection state indexed by file descriptor (fds are small and dense)
+    std::vector<std::unique_ptr<Client>> clients;
+    // Rooms with at least one member on this reactor; Room addresses are
+    // stable (node-based map), so clients can point at theirs
+    std::unordered_map<std::string, Room> rooms;
+    // Recent chat messages per room, kept even while nobody is in the room
+    ScrollbackRooms<BroadcastPtr> scrollback;
+    // Slow consumers to disconnect once the current broadcast has finished
+    std::vector<int> evictions;
+    // Shared by all connections: every read batch is fully consumed before
+    // the next socket is read, so no per-connection input buffer is needed.
+    LineFramer inFramer{READ_CHUNK};
+    // Fixed replies, allocated once and shared by every connection
+    const SharedBuffer welcome = makeSharedBuffer("WELCOME: send \"LOGIN <username>\" to join\n");
+    const SharedBuffer loginRequired = makeSharedBuffer("ERROR You must login first with: LOGIN <username>\n");
+    // "+z": this reactor's compressor and its output buffer
+    MessageCompressor compressor;
+    std::string deflateScratch;
+
+    // --io-uring only: the ring, its receive buffers, clients with output
+    // to submit, and closed clients the kernel still holds requests for
+    std::unique_ptr<IoUring> uring;
+    BufferRing recvBuffers;
+    std::vector<Client*> pendingSends;
+    // --io-uring: multishot requests (user data) to arm once the submission
+    // queue has room again
+    std::vector<uint64_t> pendingArms;
+    std::unordered_map<Client*, std::unique_ptr<Client>> retired;
+
+    // io_uring user data: a Client pointer (8-byte aligned) | operation
+    enum UringOp : uint64_t { OP_ACCEPT = 1, OP_WAKE = 2, OP_RECV = 3, OP_SEND = 4, OP_ACCEPT_UNIX = 5 };
+    static constexpr uint64_t OP_MASK = 7;
+
+    static uint64_t userData(Client *c, UringOp op) { return (uint64_t)(uintptr_t)c | op; }
+
+    /**
+     * @brief The epoll event loop (default).
+     */
+    void runEpoll() {
+        std::vector<epoll_event> events(MAX_EVENTS);
+        while (true) {
+            int n = epoll_wait(epollFd, events.data(), MAX_EVENTS, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+                return;
+            }
+
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd || fd == unixFd) {
+                    acceptClients(fd);
+                    continue;
+                }
+                if (fd == wakeFd) {
+                    drainInbox();
+                    continue;
+                }
+
+                Client *c = clientFor(fd);
+                if (!c) continue; // Closed earlier in this batch
+
+                uint32_t ev = events[i].events;
+                if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    if (handleReadable(*c) && (ev & EPOLLOUT)) flushOutput(*c);
+                } else if (ev & EPOLLOUT) {
+                    flushOutput(*c);
+                }
+                closeEvicted();
+            }
+        }
+    }
+
+    /**
+     * @brief The io_uring event loop (--io-uring). Accept and recv stay
+     * armed (multishot); sends queued while handling completions are
+     * submitted together with the next wait.
+     */
+    void runUring() {
+        std::string error;
+        uring.reset(new IoUring());
+        if (!uring->init(URING_ENTRIES, error) ||
+            !recvBuffers.init(*uring, RECV_GROUP, RECV_BUFFERS, RECV_BUFFER_SIZE, error)) {
+            std::cerr << "io_uring setup failed: " << error << std::endl;
+            return;
+        }
+        arm(OP_ACCEPT);
+        if (unixFd >= 0) arm(OP_ACCEPT_UNIX);
+        arm(OP_WAKE);
+
+        while (true) {
+            armPending();
+            submitSends();
+            int r = uring->submitAndWait();
+            if (r < 0 && r != -EINTR && r != -EBUSY) {
+                std::cerr << "io_uring_enter failed: " << strerror(-r) << std::endl;
+                return;
+            }
+            uring->forEachCompletion([this](const io_uring_cqe &cqe) {
+                handleCompletion(cqe);
+                closeEvicted();
+            });
+        }
+    }
+
+    void handleCompletion(const io_uring_cqe &cqe) {
+        Client *c = reinterpret_cast<Client*>((uintptr_t)(cqe.user_data & ~OP_MASK));
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+        switch (cqe.user_data & OP_MASK) {
+        case OP_ACCEPT:
+            if (cqe.res >= 0) addClient(cqe.res);
+            else if (cqe.res != -ECONNABORTED && cqe.res != -EINTR) logLine("accept failed: ", strerror(-cqe.res));
+            if (!more) arm(OP_ACCEPT);
+            break;
+        case OP_ACCEPT_UNIX:
+            if (cqe.res >= 0) addClient(cqe.res, false);
+            else if (cqe.res != -ECONNABORTED && cqe.res != -EINTR) logLine("accept failed: ", strerror(-cqe.res));
+            if (!more) arm(OP_ACCEPT_UNIX);
+            break;
+        case OP_WAKE:
+            drainInbox();
+            if (!more) arm(OP_WAKE);
+            break;
+        case OP_RECV:
+            handleRecvCompletion(*c, cqe);
+            break;
+        case OP_SEND:
+            handleSendCompletion(*c, cqe);
+            break;
+        }
+    }
+
+    void armRecv(Client &c) {
+        arm(userData(&c, OP_RECV));
+        c.recvArmed = true; // Also while pending, so the client is not released
+    }
+
+    /**
+     * @brief Arms a multishot accept, wake-up poll or recv. If the kernel
+     * takes no submissions for now, armPending() retries before the next wait.
+     */
+    void arm(uint64_t data) {
+        io_uring_sqe *sqe = uring->sqe();
+        if (!sqe) {
+            pendingArms.push_back(data);
+            return;
+        }
+        switch (data & OP_MASK) {
+        case OP_ACCEPT:
+            prepAcceptMultishot(sqe, listenFd, SOCK_CLOEXEC, OP_ACCEPT);
+            break;
+        case OP_ACCEPT_UNIX:
+            prepAcceptMultishot(sqe, unixFd, SOCK_CLOEXEC, OP_ACCEPT_UNIX);
+            break;
+        case OP_WAKE:
+            prepPoll(sqe, wakeFd, POLLIN, true, OP_WAKE);
+            break;
+        case OP_RECV:
+            prepRecvMultishot(sqe, reinterpret_cast<Client*>((uintptr_t)(data & ~OP_MASK))->fd,
+                              RECV_GROUP, data);
+            break;
+        }
+    }
+
+    void armPending() {
+        if (pendingArms.empty()) return;
+        std::vector<uint64_t> arms;
+        arms.swap(pendingArms);
+        for (uint64_t data : arms) {
+            Client *c = reinterpret_cast<Client*>((uintptr_t)(data & ~OP_MASK));
+            if ((data & OP_MASK) == OP_RECV && c->closed) {
+                c->recvArmed = false;
+                release(*c);
+                continue;
+            }
+            arm(data);
+        }
+    }
+
+    /**
+     * @brief One chunk of input (or the end of it) from a multishot recv.
+     */
+    void handleRecvCompletion(Client &c, const io_uring_cqe &cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) c.recvArmed = false;
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            if (cqe.res > 0) metrics.bytesIn.add(cqe.res);
+            if (cqe.res > 0 && !c.closed && !c.closing) {
+                handleReceived(c, recvBuffers.data(bid), cqe.res, cqe.flags & IORING_CQE_F_SOCK_NONEMPTY);
+            }
+            recvBuffers.recycle(bid);
+        }
+        if (c.closed) {
+            release(c);
+            return;
+        }
+        // ENOBUFS only means the buffers ran out for a moment: re-arm
+        if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS)) {
+            if (cqe.res < 0) logLine("Socket error ", strerror(-cqe.res));
+            flushCarry(c); // The end of input ends the last line too
+            closeClient(c);
+            release(c);
+            return;
+        }
+        if (!c.recvArmed) armRecv(c);
+    }
+
+    /**
+     * @brief io_uring counterpart of handleReadable() for one received chunk.
+     * @param more The socket had more data queued after this chunk: the read
+     *        batch goes on, so an unfinished line waits for the next chunk.
+     *        Otherwise the batch ends here, as at EAGAIN with epoll.
+     */
+    void handleReceived(Client &c, const char *data, size_t n, bool more) {
+        if (!c.frames) {
+            if (!c.carry.empty()) {
+                inFramer.append(c.carry.data(), c.carry.size());
+                c.carry.clear();
+            }
+            inFramer.append(data, n);
+            if (!handleLines(c)) {
+                if (more) {
+                    c.carry.assign(inFramer.pending());
+                    inFramer.clear();
+                } else {
+                    finishLines(c);
+                }
+                return;
+            }
+        } else {
+            c.frames->append(data, n);
+        }
+        if (!handleFrameBatch(c)) closeClient(c);
+    }
+
+    /**
+     * @brief Handles an unfinished line kept from the last chunk as complete.
+     */
+    void flushCarry(Client &c) {
+        if (c.carry.empty() || c.frames) return;
+        inFramer.append(c.carry.data(), c.carry.size());
+        c.carry.clear();
+        finishLines(c);
+    }
+
+    /**
+     * @brief Lists c for the next batched submission. Only one send per
+     * client is in flight at a time, so its bytes stay in order.
+     */
+    void queueSend(Client &c) {
+        if (c.sending || c.sendListed) return;
+        c.sendListed = true;
+        pendingSends.push_back(&c);
+    }
+
+    /**
+     * @brief Prepares one SENDMSG per listed client, covering the front of
+     * everything it has queued; the next io_uring_enter() submits them all.
+     * Clients that find the submission queue full stay listed for the next
+     * round.
+     */
+    void submitSends() {
+        size_t done = 0;
+        for (; done < pendingSends.size(); ++done) {
+            Client *c = pendingSends[done];
+            if (c->closed || c->out.empty()) {
+                c->sendListed = false;
+                release(*c);
+                continue;
+            }
+            io_uring_sqe *sqe = uring->sqe();
+            if (!sqe) break;
+            c->sendListed = false;
+            if (!c->send) c->send.reset(new UringSend());
+            UringSend &s = *c->send;
+            s.msg.msg_iov = s.iov;
+            s.msg.msg_iovlen = c->out.gather(s.iov, OutputQueue::MAX_IOV);
+            prepSendmsg(sqe, c->fd, &s.msg, MSG_NOSIGNAL, userData(c, OP_SEND));
+            c->sending = true;
+        }
+        pendingSends.erase(pendingSends.begin(), pendingSends.begin() + done);
+    }
+
+    void handleSendCompletion(Client &c, const io_uring_cqe &cqe) {
+        c.sending = false;
+        if (c.closed) {
+            release(c);
+            return;
+        }
+        if (cqe.res < 0) {
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                queueSend(c);
+                return;
+            }
+            // EPIPE: the peer is gone, which its recv reports as well
+            if (cqe.res != -EPIPE) logLine("Socket error ", strerror(-cqe.res));
+            closeClient(c);
+            release(c);
+            return;
+        }
+        c.out.consume((size_t)cqe.res);
+        metrics.bytesOut.add(cqe.res);
+        metrics.queuedBytes.sub(cqe.res);
+        if (c.congested && c.out.bytesQueued() <= opts.lowWater) recover(c);
+        if (!c.out.empty()) {
+            queueSend(c);
+        } else if (c.closing) {
+            closeClient(c);
+            release(c);
+        }
+    }
+
+    /**
+     * @brief Frees a closed client once the kernel holds no request for it.
+     */
+    void release(Client &c) {
+        if (c.closed && !c.recvArmed && !c.sending && !c.sendListed) retired.erase(&c);
+    }
+
+    Client *clientFor(int fd) {
+        if (fd < 0 || (size_t)fd >= clients.size()) return nullptr;
+        return clients[fd].get();
+    }
+
+    /**
+     * @brief Delivers every broadcast other reactors queued for this one.
+     */
+    void drainInbox() {
+        uint64_t count;
+        (void)!read(wakeFd, &count, sizeof(count));
+        // Clear the flag first: a post() after this point signals again
+        wakePending.exchange(false, std::memory_order_acq_rel);
+        BroadcastPtr b;
+        while (inbox.pop(b)) {
+            if (b->recipient) deliverDirect(*b);
+            else deliver(nullptr, b);
+        }
+        closeEvicted();
+    }
+
+    /**
+     * @brief Accepts every pending connection on a listener (required with EPOLLET).
+     */
+    void acceptClients(int listener) {
+        while (true) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    logLine("accept failed: ", strerror(errno));
+                }
+                return;
+            }
+
+            addClient(fd, listener == listenFd);
+        }
+    }
+
+    /**
+     * @brief Sets up a freshly accepted connection and greets it.
+     * @param tcp Accepted on the TCP listener rather than the Unix socket.
+     */
+    void addClient(int fd, bool tcp = true) {
+        if (tcp) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        if ((size_t)fd >= clients.size()) clients.resize(fd + 1);
+        clients[fd].reset(new Client());
+        Client &c = *clients[fd];
+        c.fd = fd;
+        metrics.connections.add();
+
+        if (uring) {
+            armRecv(c);
+        } else {
+            // Register once for both directions; edges tell us when to retry.
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        }
+
+        sendTo(c, welcome);
+    }
+
+    /**
+     * @brief Drains a readable socket and processes every line in it.
+     * @return false if the connection was closed.
+     */
+    bool handleReadable(Client &c) {
+        if (c.frames) return handleFrames(c);
+
+        bool peerClosed = false;
+
+        while (!c.closing) {
+            char *dst = inFramer.writePtr(READ_CHUNK); // Must run before writable()
+            ssize_t n = recv(c.fd, dst, inFramer.writable(), 0);
+            if (n > 0) {
+                metrics.bytesIn.add(n);
+                inFramer.commit(n);
+                if (handleLines(c)) return handleFrames(c);
+                continue;
+            }
+            if (n == 0) {
+                peerClosed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                logLine("Socket error ", strerror(errno));
+                peerClosed = true;
+            }
+            break;
+        }
+        finishLines(c);
+
+        if (peerClosed || (c.closing && c.out.empty())) {
+            closeClient(c);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Handles every complete line in inFramer.
+     * @return true if LOGIN switched the client to frames; the bytes after
+     *         the LOGIN line have then moved to its FrameDecoder.
+     */
+    bool handleLines(Client &c) {
+        std::string_view line;
+        while (!c.closing && inFramer.nextLine(line)) {
+            // Empty lines are skipped, like .filter(Boolean) in server.js
+            if (!line.empty()) handleLine(c, line);
+            if (c.frames) {
+                // LOGIN switched this client to frames mid-batch
+                std::string_view rest = inFramer.pending();
+                c.frames->append(rest.data(), rest.size());
+                inFramer.clear();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Ends a read batch. server.js splits each 'data' chunk on its
+     * own, so a trailing line without "\n" is still a complete message
+     * there. Do the same for everything read in this batch so newline-less
+     * clients work.
+     */
+    void finishLines(Client &c) {
+        if (!c.closing && inFramer.buffered() > 0) {
+            std::string_view tail = inFramer.pending();
+            if (tail.back() == '\r') tail.remove_suffix(1);
+            if (!tail.empty()) handleLine(c, tail);
+        }
+        inFramer.clear();
+    }
+
+    /**
+     * @brief Binary counterpart of handleReadable(): reads straight into the
+     * client's FrameDecoder and handles every complete TEXT frame.
+     * @return false if the connection was closed.
+     */
+    bool handleFrames(Client &c) {
+        bool peerClosed = false;
+
+        while (!c.closing) {
+            if (!handleFrameBatch(c)) {
+                peerClosed = true;
+                break;
+            }
+            if (c.closing) break;
+
+            char *dst = c.frames->writePtr(); // Must run before writable()
+            ssize_t n = recv(c.fd, dst, c.frames->writable(), 0);
+            if (n > 0) {
+                metrics.bytesIn.add(n);
+                c.frames->commit(n);
+                continue;
+            }
+            if (n == 0) {
+                peerClosed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                logLine("Socket error ", strerror(errno));
+                peerClosed = true;
+            }
+            break;
+        }
+
+        if (peerClosed || (c.closing && c.out.empty())) {
+            closeClient(c);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Handles every complete TEXT frame buffered for c.
+     * @return false if the client sent an oversized frame.
+     */
+    bool handleFrameBatch(Client &c) {
+        FrameHeader header;
+        std::string_view payload;
+        FrameDecoder::Result r = FrameDecoder::Result::NeedMore;
+        while (!c.closing && (r = c.frames->next(header, payload)) == FrameDecoder::Result::Frame) {
+            if (header.type == FRAME_TEXT && !payload.empty()) handleLine(c, payload);
+        }
+        if (!c.closing && r == FrameDecoder::Result::Error) {
+            logLine("Oversized frame from ", c.username, ", disconnecting");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Protocol state machine for one received line.
+     */
+    void handleLine(Client &c, std::string_view line) {
+        metrics.messagesIn.add();
+        if (!c.loggedIn) {
+            std::string_view cmd = trim(line);
+            // Equivalent of: parts = line.trim().split(' '); parts[0] === 'LOGIN' && parts[1]
+            size_t sp = cmd.find(' ');
+            if (sp != std::string_view::npos && cmd.compare(0, sp, "LOGIN") == 0 &&
+                sp + 1 < cmd.size() && cmd[sp + 1] != ' ') {
+                LoginCapabilities caps;
+                c.username = std::string(stripLoginCapabilities(cmd.substr(sp + 1), caps));
+                c.loggedIn = true;
+                c.numbered = caps.numbered;
+                c.sessionId = shared.sessionIds.fetch_add(1, std::memory_order_relaxed) + 1;
+                metrics.logins.add();
+                metrics.sessions.add();
+                shared.users.add(c.username, SessionRef{this, c.fd, c.sessionId});
+                enterRoom(c, std::string(isValidRoomName(caps.room) ? caps.room : DEFAULT_ROOM));
+                logLine("User logged in: ", c.username);
+                std::string reply = "LOGIN_OK ";
+                if (caps.binary) {
+                    // The last text line; everything after it (scrollback too) is framed
+                    reply.append(BINARY_CAPABILITY).append(" ");
+                    c.frames.reset(new FrameDecoder());
+                    if (caps.compressed) {
+                        reply.append(COMPRESSION_CAPABILITY).append(" ");
+                        c.compressed = true;
+                        shared.compressedSessions.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                if (caps.numbered) reply.append(SEQUENCE_CAPABILITY).append(" ");
+                reply.append("Welcome, ").append(c.username).append("\n");
+                if (c.room->name != DEFAULT_ROOM) appendLine(c, reply, "JOIN_OK " + c.room->name);
+                // A sequence from before a restart without --log-dir means nothing here
+                uint64_t since = caps.since;
+                if (since > shared.broadcastSeq.load(std::memory_order_relaxed)) since = 0;
+                appendScrollback(c, reply, since);
+                sendTo(c, makeSharedBuffer(std::move(reply)));
+                broadcast(&c, c.room->name, "SERVER: " + c.username + " has joined the chat");
+            } else {
+                sendTo(c, loginRequired);
+            }
+            return;
+        }
+
+        std::string_view text = trim(line);
+        if (equalsIgnoreCase(text, "/quit")) {
+            sendLine(c, "BYE");
+            c.closing = true;
+            return;
+        }
+        std::string_view room;
+        if (commandArgument(text, "/join", room)) {
+            if (!isValidRoomName(room)) {
+                sendLine(c, "ERROR Room names are 1-" + std::to_string(MAX_ROOM_NAME) +
+                            " letters, digits, '-' or '_'");
+            } else {
+                switchRoom(c, std::string(room));
+                std::string reply;
+                appendLine(c, reply, "JOIN_OK " + c.room->name);
+                appendScrollback(c, reply);
+                sendTo(c, makeSharedBuffer(std::move(reply)));
+            }
+            return;
+        }
+        std::string_view arg;
+        if (commandArgument(text, "/msg", arg)) {
+            whisper(c, arg);
+            return;
+        }
+        if (commandArgument(text, "/part", room)) {
+            if (c.room->name == DEFAULT_ROOM) {
+                sendLine(c, "ERROR You are not in a room");
+            } else {
+                std::string left = c.room->name;
+                switchRoom(c, std::string(DEFAULT_ROOM));
+                sendLine(c, "PART_OK " + left);
+            }
+            return;
+        }
+
+        std::string out = formatChatLine(c.username, text);
+        if (opts.verbose) logLine("MSG -> ", out);
+        broadcast(&c, c.room->name, out, true);
+    }
+
+    /**
+     * @brief Matches "<command>" or "<command> <argument>", ignoring case.
+     */
+    static bool commandArgument(std::string_view text, const char *command, std::string_view &arg) {
+        size_t sp = text.find(' ');
+        if (!equalsIgnoreCase(text.substr(0, sp), command)) return false;
+        arg = sp == std::string_view::npos ? std::string_view() : trim(text.substr(sp + 1));
+        return true;
+    }
+
+    /**
+     * @brief Handles "/msg <user> <text>": O(1) lookup, then delivery on the
+     * recipient's reactor (directly if that is this one).
+     */
+    void whisper(Client &c, std::string_view arg) {
+        std::string_view name, body;
+        if (!splitRecipient(arg, name, body) || body.empty()) {
+            sendLine(c, "ERROR Usage: /msg <user> <text>");
+            return;
+        }
+        std::string to(name);
+        SessionRef target;
+        if (!shared.users.find(to, target)) {
+            sendLine(c, "ERROR No such user: " + to);
+            return;
+        }
+
+        auto b = std::make_shared<Broadcast>();
+        b->text = "WHISPER from " + c.username + ": ";
+        b->text.append(body);
+        b->line = makeSharedBuffer(b->text + "\n");
+        b->fd = target.fd;
+        b->recipient = target.id;
+        if (target.reactor == this) deliverDirect(*b);
+        else target.reactor->post(std::move(b));
+
+        std::string echo = "WHISPER to " + to + ": ";
+        echo.append(body);
+        sendLine(c, echo);
+    }
+
+    /**
+     * @brief Splits "<user> <text>" or "\"<user name>\" <text>".
+     */
+    static bool splitRecipient(std::string_view arg, std::string_view &name, std::string_view &body) {
+        size_t end;
+        if (!arg.empty() && arg[0] == '"') {
+            end = arg.find('"', 1);
+            if (end == std::string_view::npos) return false;
+            name = arg.substr(1, end - 1);
+            ++end;
+        } else {
+            end = arg.find(' ');
+            name = arg.substr(0, end);
+        }
+        body = end < arg.size() ? trim(arg.substr(end)) : std::string_view();
+        return !name.empty();
+    }
+
+    /**
+     * @brief Adds a logged-in client to a room (creating this reactor's shard).
+     */
+    void enterRoom(Client &c, const std::string &name) {
+        Room &room = rooms[name];
+        if (room.name.empty()) room.name = name;
+        c.room = &room;
+        c.memberIndex = room.members.size();
+        room.members.push_back(&c);
+    }
+
+    /**
+     * @brief Removes a client from its room; the shard goes once it is empty.
+     */
+    void leaveRoom(Client &c) {
+        Room *room = c.room;
+        // O(1) removal: move the last member into the freed slot
+        Client *last = room->members.back();
+        room->members[c.memberIndex] = last;
+        last->memberIndex = c.memberIndex;
+        room->members.pop_back();
+        c.room = nullptr;
+        if (room->members.empty()) rooms.erase(room->name);
+    }
+
+    /**
+     * @brief Moves a client to another room and notifies both rooms.
+     */
+    void switchRoom(Client &c, const std::string &name) {
+        if (c.room->name == name) return;
+        std::string old = c.room->name;
+        leaveRoom(c);
+        broadcast(&c, old, "SERVER: " + c.username + " has left #" + old);
+        enterRoom(c, name);
+        broadcast(&c, name, "SERVER: " + c.username + " has joined #" + name);
+    }
+
+    /**
+     * @brief Sends one line to every member of a room except the sender,
+     * on this reactor and (through their inboxes) on all others.
+     * The message is serialized once into an immutable shared buffer;
+     * every peer gets (and, if slow, queues) a reference to it. Notices are
+     * logged too, so a restart never reissues a sequence number.
+     * @param chat A chat message (as opposed to a notice): kept as scrollback.
+     * @return The broadcast's sequence number.
+     */
+    uint64_t broadcast(Client *sender, const std::string &room, const std::string &message,
+                       bool chat = false) {
+        auto b = std::make_shared<Broadcast>();
+        b->seq = shared.broadcastSeq.fetch_add(1, std::memory_order_relaxed) + 1;
+        b->room = room;
+        b->text = message;
+        b->line = makeSharedBuffer(message + "\n");
+        b->chat = chat;
+        if (shared.log) shared.log->append(b->seq, room, message, chat ? LOG_CHAT : LOG_NOTICE);
+        if (shared.compressedSessions.load(std::memory_order_relaxed) > 0) {
+            b->deflated = deflatedFrame(b->seq, message);
+        }
+
+        BroadcastPtr handoff = std::move(b);
+        deliver(sender, handoff);
+        for (Reactor *r : shared.reactors) {
+            if (r != this) r->post(handoff);
+        }
+        return handoff->seq;
+    }
+
+    /**
+     * @brief Hands a broadcast to this reactor's members of its room.
+     * @param sender Excluded recipient (null for broadcasts from other reactors).
+     */
+    void deliver(Client *sender, const BroadcastPtr &ptr) {
+        const Broadcast &b = *ptr;
+        if (b.chat && opts.scrollback > 0) remember(ptr);
+        auto it = rooms.find(b.room);
+        if (it == rooms.end()) return; // Nobody in that room on this reactor
+        auto start = std::chrono::steady_clock::now();
+        const std::vector<Client*> &members = it->second.members;
+        SharedBuffer frame;    // Built once per reactor, only if a binary peer exists
+        SharedBuffer numbered; // Likewise for "+seq" text peers
+        for (size_t i = 0; i < members.size(); ++i) {
+            Client *peer = members[i];
+            if (peer == sender || !admitBroadcast(*peer)) continue;
+            if (!peer->frames && !peer->numbered) {
+                sendTo(*peer, b.line);
+                continue;
+            }
+            if (!peer->frames) {
+                if (!numbered) {
+                    std::string bytes;
+                    appendLine(*peer, bytes, b.text, b.seq);
+                    numbered = makeSharedBuffer(std::move(bytes));
+                }
+                sendTo(*peer, numbered);
+                continue;
+            }
+            if (peer->compressed && b.deflated) {
+                countCompressed(*peer, b.text.size(), b.deflated->size());
+                sendTo(*peer, b.deflated);
+                continue;
+            }
+            if (!frame) {
+                std::string bytes;
+                appendFrame(bytes, FRAME_TEXT, b.seq, b.text);
+                frame = makeSharedBuffer(std::move(bytes));
+            }
+            if (peer->compressed) countCompressed(*peer, b.text.size(), frame->size());
+            sendTo(*peer, frame);
+        }
+        metrics.fanout.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    /**
+     * @brief Compresses a broadcast into the frame all "+z" recipients share.
+     * @return null if the text does not get smaller.
+     */
+    SharedBuffer deflatedFrame(uint64_t seq, std::string_view text) {
+        if (!compressor.compress(text, deflateScratch)) return nullptr;
+        std::string bytes;
+        appendFrame(bytes, FRAME_TEXT, seq, deflateScratch, FRAME_FLAG_DEFLATE);
+        return makeSharedBuffer(std::move(bytes));
+    }
+
+    /**
+     * @brief Accounts for a broadcast frame sent to a "+z" client.
+     */
+    void countCompressed(Client &c, size_t textBytes, size_t sentBytes) {
+        c.compression.add(FRAME_HEADER_SIZE + textBytes, sentBytes);
+        metrics.compressedPlainBytes.add(FRAME_HEADER_SIZE + textBytes);
+        metrics.compressedSentBytes.add(sentBytes);
+    }
+
+    /**
+     * @brief Hands a direct message to its recipient, if still connected.
+     * Subject to the same slow-consumer policy as broadcasts.
+     */
+    void deliverDirect(const Broadcast &b) {
+        Client *peer = clientFor(b.fd);
+        if (!peer || peer->sessionId != b.recipient || !admitBroadcast(*peer)) return;
+        if (!peer->frames) {
+            sendTo(*peer, b.line);
+            return;
+        }
+        std::string bytes;
+        if (peer->compressed && compressor.compress(b.text, deflateScratch)) {
+            appendFrame(bytes, FRAME_TEXT, 0, deflateScratch, FRAME_FLAG_DEFLATE);
+        } else {
+            appendFrame(bytes, FRAME_TEXT, 0, b.text);
+        }
+        if (peer->compressed) countCompressed(*peer, b.text.size(), bytes.size());
+        sendTo(*peer, makeSharedBuffer(std::move(bytes)));
+    }
+
+    /**
+     * @brief Applies the slow-consumer policy before a broadcast to peer.
+     * @return false if the broadcast must not be queued for this peer.
+     */
+    bool admitBroadcast(Client &peer) {
+        if (peer.evicted) return false;
+        size_t queued = peer.out.bytesQueued();
+        if (peer.congested) {
+            if (queued > opts.lowWater) {
+                withhold(peer);
+                return false;
+            }
+            recover(peer);
+        }
+        if (queued < opts.highWater) return true;
+
+        if (opts.slowPolicy == SlowPolicy::Disconnect) {
+            logLine("Disconnecting slow consumer ", peer.username, " (", queued, " bytes queued)");
+            metrics.slowDisconnects.add();
+            peer.evicted = true;
+            evictions.push_back(peer.fd);
+            return false;
+        }
+        logLine("Slow consumer ", peer.username, " (", queued, " bytes queued): withholding broadcasts");
+        peer.congested = true;
+        metrics.congestedClients.add();
+        withhold(peer);
+        return false;
+    }
+
+    void withhold(Client &peer) {
+        ++peer.skipped;
+        metrics.withheld.add();
+    }
+
+    /**
+     * @brief Ends congestion once the queue is back below the low watermark.
+     */
+    void recover(Client &c) {
+        c.congested = false;
+        metrics.congestedClients.sub();
+        logLine("Slow consumer ", c.username, " caught up after ", c.skipped, " withheld messages");
+        if (opts.slowPolicy == SlowPolicy::Coalesce) {
+            sendLine(c, "SERVER: " + std::to_string(c.skipped) +
+                        " messages were skipped because your connection fell behind");
+        }
+        c.skipped = 0;
+    }
+
+    /**
+     * @brief Closes the connections evicted by the disconnect policy.
+     * Deferred so that broadcast() never modifies a room while walking it.
+     */
+    void closeEvicted() {
+        while (!evictions.empty()) {
+            Client *c = clientFor(evictions.back());
+            evictions.pop_back();
+            if (c && c->evicted) {
+                closeClient(*c);
+                if (uring) release(*c);
+            }
+        }
+    }
+
+    /**
+     * @brief Sends a direct reply in whatever framing the client negotiated.
+     */
+    void sendLine(Client &c, std::string_view text) {
+        std::string bytes;
+        appendLine(c, bytes, text);
+        sendTo(c, makeSharedBuffer(std::move(bytes)));
+    }
+
+    /**
+     * @brief Appends one line to out in the client's framing.
+     * @param seq Broadcast sequence for binary frames and "+seq" text
+     *        clients (0 for direct replies).
+     */
+    static void appendLine(const Client &c, std::string &out, std::string_view text, uint64_t seq = 0) {
+        if (c.frames) {
+            appendFrame(out, FRAME_TEXT, seq, text);
+        } else {
+            if (c.numbered && seq) appendSequencePrefix(out, seq);
+            out.append(text.data(), text.size());
+            out.push_back('\n');
+        }
+    }
+
+    /**
+     * @brief Adds a chat message to its room's scrollback. Every reactor keeps
+     * the history, so whoever joins can replay it. Broadcasts posted by other
+     * reactors can overtake each other, so the ring is kept in sequence order.
+     */
+    void remember(const BroadcastPtr &ptr) {
+        scrollback.pushOrdered(ptr->room, ptr, [](const BroadcastPtr &a, const BroadcastPtr &b) {
+            return a->seq < b->seq;
+        });
+    }
+
+    /**
+     * @brief Appends the scrollback of the client's room to out, oldest first,
+     * so it reaches the client in the same write as the preceding reply.
+     * @param since Only messages with a higher sequence ("+seq=<n>" resume).
+     */
+    void appendScrollback(Client &c, std::string &out, uint64_t since = 0) {
+        const ScrollbackRing<BroadcastPtr> *ring = scrollback.find(c.room->name);
+        if (!ring) return;
+        size_t count = 0;
+        ring->forEach([&](const BroadcastPtr &b) { count += b->seq > since; });
+        if (count == 0) return;
+        appendLine(c, out, "HISTORY " + std::to_string(count));
+        ring->forEach([&](const BroadcastPtr &b) {
+            if (b->seq <= since) return;
+            size_t before = out.size();
+            if (c.compressed && b->deflated) out.append(*b->deflated);
+            else appendLine(c, out, b->text, b->seq);
+            if (c.compressed) countCompressed(c, b->text.size(), out.size() - before);
+        });
+    }
+
+    /**
+     * @brief Writes a buffer to a client, queueing whatever the kernel rejects.
+     * Writes go straight to the socket while nothing is queued; once a
+     * backlog exists, new buffers are queued and EPOLLOUT drains them in order.
+     * Hard errors are left to the EPOLLERR/EPOLLHUP edge that follows.
+     * With io_uring the buffer is only queued; submitSends() sends it.
+     */
+    void sendTo(Client &c, const SharedBuffer &data) {
+        metrics.messagesOut.add();
+        size_t before = c.out.bytesQueued();
+        if (uring) {
+            c.out.enqueue(data);
+            queueSend(c);
+        } else {
+            c.out.write(c.fd, data);
+        }
+        countOutput(c, before, data->size());
+    }
+
+    /**
+     * @brief Accounts for c's output queue after `added` bytes were queued
+     * on top of `before`: whatever is not queued now went to the kernel.
+     */
+    void countOutput(const Client &c, size_t before, size_t added) {
+        size_t queued = c.out.bytesQueued();
+        metrics.bytesOut.add(before + added - queued);
+        metrics.queuedBytes.add((int64_t)queued - (int64_t)before);
+    }
+
+    /**
+     * @brief Retries queued output after an EPOLLOUT edge.
+     */
+    void flushOutput(Client &c) {
+        size_t before = c.out.bytesQueued();
+        OutputQueue::Status status = c.out.flush(c.fd);
+        countOutput(c, before, 0);
+        if (c.congested && c.out.bytesQueued() <= opts.lowWater) {
+            recover(c);
+            before = c.out.bytesQueued();
+            if (status == OutputQueue::Status::Drained) status = c.out.flush(c.fd);
+            countOutput(c, before, 0);
+        }
+        if (status == OutputQueue::Status::Blocked) return;
+        // Drained, or a hard error: the EPOLLERR/EPOLLHUP edge closes the client
+        metrics.queuedBytes.sub(c.out.bytesQueued());
+        c.out.clear();
+        if (c.closing) closeClient(c);
+    }
+
+    /**
+     * @brief Tears down a connection and announces the departure.
+     */
+    void closeClient(Client &c) {
+        int fd = c.fd;
+        if (uring) {
+            // Ends the multishot recv (BYE is already sent), so the kernel
+            // lets go of c and release() can free it
+            shutdown(fd, SHUT_RDWR);
+        } else {
+            if (c.closing) shutdown(fd, SHUT_WR); // Deliver BYE before the FIN
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+        close(fd);
+
+        std::unique_ptr<Client> owned = std::move(clients[fd]);
+        // Whatever is still queued will never be sent (an io_uring send in
+        // flight completes on a closed client and is not counted either)
+        metrics.queuedBytes.sub(owned->out.bytesQueued());
+        metrics.connections.sub();
+        if (owned->congested) metrics.congestedClients.sub();
+        if (owned->loggedIn) {
+            metrics.sessions.sub();
+            std::string room = owned->room->name;
+            leaveRoom(*owned);
+            shared.users.remove(owned->username, SessionRef{this, fd, owned->sessionId});
+            logLine("User disconnected: ", owned->username);
+            if (owned->compressed) {
+                shared.compressedSessions.fetch_sub(1, std::memory_order_relaxed);
+                logLine("Compression for ", owned->username, ": ", owned->compression.describe());
+            }
+            broadcast(owned.get(), room, "SERVER: " + owned->username + " has left the chat");
+        }
+        if (uring) {
+            owned->closed = true;
+            Client *key = owned.get();
+            retired[key] = std::move(owned);
+        }
+    }
+
+    static std::string_view trim(std::string_view s) {
+        size_t b = s.find_first_not_of(" \t\r\n\f\v");
+        if (b == std::string_view::npos) return {};
+        size_t e = s.find_last_not_of(" \t\r\n\f\v");
+        return s.substr(b, e - b + 1);
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, const char *b) {
+        size_t len = strlen(b);
+        if (a.size() != len) return false;
+        for (size_t i = 0; i < len; ++i) {
+            if (tolower((unsigned char)a[i]) != b[i]) return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Owns the reactors and their threads.
+ */
+class ChatServer {
+public:
+    explicit ChatServer(const ServerOptions &options) : opts(options) {
+        if (opts.reactors <= 0) opts.reactors = (int)std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * @brief Creates every reactor and its listener.
+     * @return true on success, false if any setup step failed.
+     */
+    bool listen() {
+        if (!opts.logDir.empty()) {
+            std::string error;
+            if (!messageLog.open(opts.logDir, opts.logSegmentBytes, opts.logSyncMs, error)) {
+                std::cerr << "Cannot open message log " << error << std::endl;
+                return false;
+            }
+            // Keep sequence numbers unique across restarts
+            shared.broadcastSeq = messageLog.lastSequence();
+            shared.log = &messageLog;
+            std::cout << "Message log in " << opts.logDir << " (last sequence "
+                      << messageLog.lastSequence() << ")" << std::endl;
+        }
+        if (opts.ioUring) {
+            // Each reactor sets up its ring on its own thread; find out here
+            // whether the kernel can do it at all
+            IoUring probe;
+            BufferRing buffers;
+            std::string error;
+            if (!probe.init(8, error) || !buffers.init(probe, RECV_GROUP, 8, 64, error)) {
+                std::cerr << "--io-uring is not available: " << error << std::endl;
+                return false;
+            }
+        }
+        for (int i = 0; i < opts.reactors; ++i) {
+            reactors.emplace_back(new Reactor(opts, shared));
+            if (!reactors.back()->listenOn(opts.port, opts.reactors > 1)) return false;
+            shared.reactors.push_back(reactors.back().get());
+        }
+        if (shared.log) {
+            // The log is read back before its writer may touch it
+            if (opts.scrollback > 0) restoreScrollback();
+            messageLog.start();
+        }
+        std::cout << "TCP chat server listening on port " << opts.port;
+        if (opts.reactors > 1) std::cout << " (" << opts.reactors << " reactors)";
+        if (opts.ioUring) std::cout << " using io_uring";
+        std::cout << std::endl;
+        if (!opts.unixPath.empty()) {
+            int fd = listenUnix(opts.unixPath, !opts.ioUring);
+            if (fd < 0) return false;
+            for (auto &reactor : reactors) reactor->shareUnixListener(fd);
+            std::cout << "Unix chat socket at " << opts.unixPath << std::endl;
+        }
+        if (opts.metricsPort > 0) {
+            metricsFd = listenMetrics(opts.metricsPort);
+            if (metricsFd < 0) return false;
+            std::cout << "Metrics on http://localhost:" << opts.metricsPort << "/metrics" << std::endl;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Runs reactor 0 on the calling thread and the others on their own.
+     */
+    void run() {
+        std::vector<std::thread> threads;
+        if (metricsFd >= 0) threads.emplace_back([this] { serveMetrics(); });
+        for (int i = 1; i < opts.reactors; ++i) {
+            threads.emplace_back([this, i] {
+                pinToCore(i);
+                reactors[i]->run();
+            });
+        }
+        if (opts.reactors > 1) pinToCore(0);
+        reactors[0]->run();
+        for (std::thread &t : threads) t.join();
+    }
+
+private:
+    ServerOptions opts;
+    MessageLog messageLog;
+    ServerShared shared;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    int metricsFd = -1;
+
+    /**
+     * @brief Refills every reactor's scrollback from the newest log segments,
+     * so a restart does not lose the history replayed on LOGIN / join.
+     */
+    void restoreScrollback() {
+        size_t restored = 0;
+        messageLog.forEachRecentRecord(SCROLLBACK_RESTORE_BYTES, [&](const LogRecord &rec) {
+            if (rec.type != LOG_CHAT) return;
+            auto b = std::make_shared<Broadcast>();
+            b->seq = rec.seq;
+            b->room = std::string(rec.room);
+            b->text = std::string(rec.text);
+            b->line = makeSharedBuffer(b->text + "\n");
+            b->chat = true;
+            BroadcastPtr ptr = std::move(b);
+            for (auto &reactor : reactors) reactor->restoreScrollback(ptr);
+            ++restored;
+        });
+        std::cout << "Scrollback restored from " << restored << " logged messages" << std::endl;
+    }
+
+    /**
+     * @brief Creates the listening Unix socket; a socket file left behind by
+     * an earlier run is replaced.
+     * @return The socket, or -1 (reported on stderr).
+     */
+    static int listenUnix(const std::string &path, bool nonBlocking) {
+        sockaddr_un addr;
+        socklen_t len;
+        if (!makeUnixAddress(path, addr, len)) {
+            std::cerr << "Invalid Unix socket path: " << path << std::endl;
+            return -1;
+        }
+        struct stat st;
+        if (!isAbstractSocket(path) && lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            unlink(path.c_str());
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0), 0);
+        if (fd < 0 || bind(fd, (sockaddr*)&addr, len) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+            std::cerr << "Failed to listen on " << path << ": " << strerror(errno) << std::endl;
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    static int listenMetrics(int port) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 16) < 0) {
+            std::cerr << "Failed to listen on metrics port " << port << ": " << strerror(errno) << std::endl;
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Answers HTTP requests on the metrics port, one at a time, on
+     * its own thread: GET /metrics sums the reactors' counters, anything
+     * else is a 404. Scrapes are rare, so blocking I/O is fine here.
+     */
+    void serveMetrics() {
+        std::vector<const ServerMetrics*> shards;
+        for (const auto &r : reactors) shards.push_back(&r->stats());
+        while (true) {
+            int fd = accept4(metricsFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                logLine("metrics accept failed: ", strerror(errno));
+                return;
+            }
+            timeval timeout{2, 0}; // A silent client must not stall the next scrape
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            std::string request;
+            char buf[1024];
+            while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) break;
+                request.append(buf, n);
+            }
+            std::string_view target(request);
+            target = target.substr(0, target.find("\r\n"));
+            bool found = target.rfind("GET /metrics ", 0) == 0 || target.rfind("GET /metrics?", 0) == 0;
+            std::string body = found ? renderMetrics(shards) : "Not found\n";
+            std::string response = found ? "HTTP/1.1 200 OK\r\n"
+                                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                         : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n";
+            response.append("Content-Length: ").append(std::to_string(body.size()));
+            response.append("\r\nConnection: close\r\n\r\n").append(body);
+            for (size_t sent = 0; sent < response.size();) {
+                ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) break;
+                sent += n;
+            }
+            close(fd);
+        }
+    }
+
+    /**
+     * @brief Pins the calling thread to the index-th CPU it may run on.
+     */
+    static void pinToCore(int index) {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+        int count = CPU_COUNT(&allowed);
+        if (count <= 1) return;
+        int target = index % count;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed) || target-- > 0) continue;
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
+        }
+    }
+};
+
+/**
+ * @brief Raises the open-file limit so tens of thousands of sessions fit.
+ */
+void raiseFileLimit() {
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+/**
+ * @brief Entry point.
+ * Usage: chatserver [--port N] [--reactors N] [--verbose]
+ *                   [--slow-policy drop|coalesce|disconnect]
+ *                   [--high-water BYTES] [--low-water BYTES]
+ *                   [--log-dir DIR] [--log-segment-mb N] [--log-sync-ms N]
+ *                   [--scrollback N] [--io-uring] [--metrics-port N]
+ *                   [--unix PATH]
+ * @return int Exit status (0 for success, non-zero for error).
+ */
+int main(int argc, char **argv) {
+    ServerOptions opts;
+    const char *usage = " [--port N] [--reactors N] [--verbose] [--slow-policy drop|coalesce|disconnect]"
+                        " [--high-water BYTES] [--low-water BYTES]"
+                        " [--log-dir DIR] [--log-segment-mb N] [--log-sync-ms N] [--scrollback N]"
+                        " [--io-uring] [--metrics-port N] [--unix PATH]";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            opts.port = std::stoi(argv[++i]);
+        } else if (arg == "--reactors" && i + 1 < argc) {
+            opts.reactors = std::stoi(argv[++i]); // 0 = one per core
+        } else if (arg == "--verbose" || arg == "-v") {
+            opts.verbose = true; // Print every message ("MSG -> ...")
+        } else if (arg == "--slow-policy" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "drop") opts.slowPolicy = SlowPolicy::Drop;
+            else if (value == "coalesce") opts.slowPolicy = SlowPolicy::Coalesce;
+            else if (value == "disconnect") opts.slowPolicy = SlowPolicy::Disconnect;
+            else {
+                std::cerr << "--slow-policy expects drop, coalesce or disconnect" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--high-water" && i + 1 < argc) {
+            opts.highWater = std::stoul(argv[++i]);
+        } else if (arg == "--low-water" && i + 1 < argc) {
+            opts.lowWater = std::stoul(argv[++i]);
+        } else if (arg == "--log-dir" && i + 1 < argc) {
+            opts.logDir = argv[++i];
+        } else if (arg == "--log-segment-mb" && i + 1 < argc) {
+            // At least 4 MiB so that the largest message always fits
+            opts.logSegmentBytes = std::max<size_t>(4, std::stoul(argv[++i])) << 20;
+        } else if (arg == "--log-sync-ms" && i + 1 < argc) {
+            opts.logSyncMs = std::stoi(argv[++i]);
+        } else if (arg == "--scrollback" && i + 1 < argc) {
+            opts.scrollback = std::stoul(argv[++i]); // 0 disables the replay
+        } else if (arg == "--io-uring") {
+            opts.ioUring = true;
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            opts.metricsPort = std::stoi(argv[++i]); // Prometheus scrape target
+        } else if (arg == "--unix" && i + 1 < argc) {
+            opts.unixPath = argv[++i]; // "@name": abstract namespace
+        } else {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        }
+    }
+    if (opts.lowWater > opts.highWater) opts.lowWater = opts.highWater;
+
+    // A peer closing mid-write must not kill the whole server
+    signal(SIGPIPE, SIG_IGN);
+    raiseFileLimit();
+
+    ChatServer server(opts);
+    if (!server.listen()) return 1;
+    server.run();
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file event_poller.hpp
+ * @brief Level-triggered readiness for the client's event loop: epoll, or
+ * io_uring poll requests (--io-uring).
+ *
+ * Both backends take and report epoll event masks (EPOLLIN, EPOLLOUT, ...,
+ * which have the same values as POLLIN, POLLOUT, ...). io_uring polls are
+ * one-shot, so wait() re-arms every watched descriptor that fired last
+ * time; the submissions go to the kernel in the same io_uring_enter() that
+ * waits, which makes a loop iteration one syscall instead of an epoll_ctl()
+ * per change plus epoll_wait().
+ */
+
+#pragma once
+
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "uring.hpp"
+
+class EventPoller {
+public:
+    EventPoller() = default;
+    EventPoller(const EventPoller &) = delete;
+    EventPoller &operator=(const EventPoller &) = delete;
+    ~EventPoller() {
+        if (epollFd >= 0) close(epollFd);
+    }
+
+    bool init(bool useUring, std::string &error) {
+        if (useUring) {
+            uring.reset(new IoUring());
+            return uring->init(8, error);
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            error = std::string("epoll_create1: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Starts watching fd.
+     * @return false with errno set; EPERM for files that cannot be polled.
+     */
+    bool add(int fd, uint32_t events) {
+        if (!uring) return ctl(EPOLL_CTL_ADD, fd, events);
+        // Regular files are always ready; keep epoll's answer for them
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        if (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode)) {
+            errno = EPERM;
+            return false;
+        }
+        if ((size_t)fd >= watches.size()) watches.resize(fd + 1);
+        watches[fd].watched = true;
+        watches[fd].events = events;
+        return true;
+    }
+
+    void modify(int fd, uint32_t events) {
+        if (!uring) {
+            ctl(EPOLL_CTL_MOD, fd, events);
+            return;
+        }
+        if (!isWatched(fd) || watches[fd].events == events) return;
+        disarm(fd);
+        watches[fd].events = events;
+    }
+
+    void remove(int fd) {
+        if (!uring) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            return;
+        }
+        if (!isWatched(fd)) return;
+        disarm(fd);
+        watches[fd].watched = false;
+    }
+
+    /**
+     * @brief Waits up to timeoutMs (-1 = no limit) for watched descriptors.
+     * @return Number of events stored, or -1 with errno set.
+     */
+    int wait(epoll_event *events, int maxEvents, int timeoutMs) {
+        if (!uring) return epoll_wait(epollFd, events, maxEvents, timeoutMs);
+
+        for (size_t fd = 0; fd < watches.size(); ++fd) {
+            Watch &w = watches[fd];
+            if (!w.watched || w.armed || w.events == 0) continue;
+            io_uring_sqe *sqe = uring->sqe();
+            if (!sqe) break; // Queue full: the rest is armed by the next wait()
+            prepPoll(sqe, (int)fd, w.events, false, userData((int)fd, w.generation));
+            w.armed = true;
+        }
+        int r = uring->submitAndWait(timeoutMs);
+        if (r < 0 && r != -ETIME) {
+            errno = -r;
+            return -1;
+        }
+
+        int n = 0;
+        uring->forEachCompletion([&](const io_uring_cqe &cqe) {
+            if (cqe.user_data == CANCEL_DATA) return;
+            int fd = (int)(uint32_t)cqe.user_data;
+            if (!isWatched(fd) || watches[fd].generation != (uint32_t)(cqe.user_data >> 32)) return;
+            watches[fd].armed = false; // Re-armed by the next wait(): level-triggered
+            if (n == maxEvents) return;
+            events[n].events = cqe.res < 0 ? (uint32_t)EPOLLERR : (uint32_t)cqe.res;
+            events[n].data.fd = fd;
+            ++n;
+        });
+        return n;
+    }
+
+private:
+    static constexpr uint64_t CANCEL_DATA = 0;
+
+    struct Watch {
+        bool watched = false;
+        bool armed = false;      // A poll request is in flight
+        uint32_t events = 0;
+        uint32_t generation = 1; // Tells stale completions from the current poll
+    };
+
+    int epollFd = -1;
+    std::unique_ptr<IoUring> uring;
+    std::vector<Watch> watches; // Indexed by fd (--io-uring)
+
+    static uint64_t userData(int fd, uint32_t generation) {
+        return ((uint64_t)generation << 32) | (uint32_t)fd;
+    }
+
+    bool isWatched(int fd) const {
+        return fd >= 0 && (size_t)fd < watches.size() && watches[fd].watched;
+    }
+
+    bool ctl(int op, int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        return epoll_ctl(epollFd, op, fd, &ev) == 0;
+    }
+
+    /**
+     * @brief Cancels the poll in flight for fd; its completion is ignored.
+     * With the submission queue full it is left to complete on its own,
+     * which the generation check ignores just the same.
+     */
+    void disarm(int fd) {
+        Watch &w = watches[fd];
+        io_uring_sqe *sqe = w.armed ? uring->sqe() : nullptr;
+        if (sqe) prepCancel(sqe, userData(fd, w.generation), CANCEL_DATA);
+        w.armed = false;
+        ++w.generation;
+    }
+};
@@ -0,0 +1,224 @@
+/**
+ * @file latency_probe.hpp
+ * @brief End-to-end broadcast latency measurement.
+ *
+ * In latency mode a sender starts every message body with a stamp
+ *
+ *     #lat:<sequence>:<monotonic send time in ns>#
+ *
+ * The server relays it untouched as "<username>: #lat:...# rest". Each
+ * receiver parses the stamp, records (now - send time) into a log-bucketed
+ * histogram and tracks sequence numbers per sender to count lost and
+ * reordered messages. CLOCK_MONOTONIC is shared by all processes on a host,
+ * so senders and receivers must run on the same machine.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ctime>        // For clock_gettime(CLOCK_MONOTONIC)
+#include <ostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Current CLOCK_MONOTONIC time in nanoseconds.
+ */
+inline uint64_t monotonicNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @brief Appends a latency stamp for the given sequence number to out.
+ */
+inline void appendLatencyStamp(std::string &out, uint64_t seq, uint64_t sendNs) {
+    out.append("#lat:").append(std::to_string(seq)).push_back(':');
+    out.append(std::to_string(sendNs)).push_back('#');
+}
+
+/**
+ * @brief Log-bucketed histogram in the style of HdrHistogram.
+ * Values below 32 are exact; above that each power of two is split into 32
+ * sub-buckets, so any recorded value is reported within ~3% of its true
+ * magnitude. The whole 64-bit range fits in a fixed 15 KiB array.
+ */
+class LatencyHistogram {
+public:
+    void record(uint64_t value) {
+        ++counts[bucketFor(value)];
+        ++total;
+        sum += value;
+        if (value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        if (other.minValue < minValue) minValue = other.minValue;
+        if (other.maxValue > maxValue) maxValue = other.maxValue;
+    }
+
+    /**
+     * @brief Value at the given quantile (0.0 - 1.0), e.g. 0.99 for p99.
+     * Returns the midpoint of the bucket holding that rank, clamped to max.
+     */
+    uint64_t percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(q * total);
+        if (rank >= total) rank = total - 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                uint64_t lo = bucketLow(i);
+                uint64_t mid = lo + (bucketWidth(i) - 1) / 2;
+                return mid > maxValue ? maxValue : (mid < minValue ? minValue : mid);
+            }
+        }
+        return maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? (double)sum / total : 0.0; }
+
+private:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB = 1ull << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t minValue = UINT64_MAX;
+    uint64_t maxValue = 0;
+
+    static size_t bucketFor(uint64_t v) {
+        if (v < SUB) return v;
+        int shift = (63 - __builtin_clzll(v)) - SUB_BITS;
+        return (shift + 1) * SUB + ((v >> shift) - SUB);
+    }
+
+    static uint64_t bucketLow(size_t i) {
+        if (i < SUB) return i;
+        int shift = (int)(i / SUB) - 1;
+        return (SUB + i % SUB) << shift;
+    }
+
+    static uint64_t bucketWidth(size_t i) {
+        return i < SUB ? 1 : 1ull << (i / SUB - 1);
+    }
+};
+
+/**
+ * @brief Per-sender sequence tracking for loss and reordering.
+ * Only gaps after the first message seen from a sender count as loss, so
+ * joining mid-conversation does not report the earlier history as lost.
+ */
+class SequenceTracker {
+public:
+    void observe(std::string_view sender, uint64_t seq) {
+        // Reuse one key buffer so steady-state lookups do not allocate
+        key.assign(sender.data(), sender.size());
+        auto it = nextExpected.find(key);
+        if (it == nextExpected.end()) {
+            nextExpected.emplace(key, seq + 1);
+            return;
+        }
+        uint64_t &expected = it->second;
+        if (seq == expected) {
+            ++expected;
+        } else if (seq > expected) {
+            lostCount += seq - expected; // May still arrive late (then reordered)
+            expected = seq + 1;
+        } else {
+            ++reorderedCount;
+            if (lostCount > 0) --lostCount;
+        }
+    }
+
+    uint64_t lost() const { return lostCount; }
+    uint64_t reordered() const { return reorderedCount; }
+
+private:
+    std::unordered_map<std::string, uint64_t> nextExpected;
+    std::string key;
+    uint64_t lostCount = 0;
+    uint64_t reorderedCount = 0;
+};
+
+/**
+ * @brief Extracts the stamp from a relayed "<username>: #lat:seq:ns#..." line.
+ * @return false if the line carries no latency stamp.
+ */
+inline bool parseLatencyLine(std::string_view line, std::string_view &sender,
+                             uint64_t &seq, uint64_t &sendNs) {
+    size_t colon = line.find(": #lat:");
+    if (colon == std::string_view::npos || colon == 0) return false;
+    sender = line.substr(0, colon);
+
+    size_t pos = colon + 7;
+    auto readNumber = [&](uint64_t &out, char terminator) {
+        size_t begin = pos;
+        out = 0;
+        while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9') {
+            out = out * 10 + (line[pos++] - '0');
+        }
+        return pos > begin && pos < line.size() && line[pos++] == terminator;
+    };
+    return readNumber(seq, ':') && readNumber(sendNs, '#');
+}
+
+/**
+ * @brief Histogram plus loss/reorder tracking for one receiver.
+ */
+class LatencyRecorder {
+public:
+    /**
+     * @brief Records a received line if it carries a latency stamp.
+     * @param trackSequence Also update loss/reorder counters for the sender.
+     * @return true if the line was a latency sample.
+     */
+    bool observe(std::string_view line, uint64_t nowNs, bool trackSequence = true) {
+        std::string_view sender;
+        uint64_t seq, sendNs;
+        if (!parseLatencyLine(line, sender, seq, sendNs)) return false;
+        histogram.record(nowNs > sendNs ? nowNs - sendNs : 0);
+        if (trackSequence) sequences.observe(sender, seq);
+        return true;
+    }
+
+    const LatencyHistogram &latencies() const { return histogram; }
+    uint64_t lost() const { return sequences.lost(); }
+    uint64_t reordered() const { return sequences.reordered(); }
+
+private:
+    LatencyHistogram histogram;
+    SequenceTracker sequences;
+};
+
+/**
+ * @brief Prints count, percentiles (in microseconds) and loss/reorder counts.
+ */
+inline void printLatencyReport(std::ostream &out, const LatencyHistogram &h,
+                               uint64_t lost, uint64_t reordered) {
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+    out << std::fixed << std::setprecision(1)
+        << "latency samples:    " << h.count() << "\n"
+        << "latency (us):       min=" << us(h.min())
+        << " mean=" << us((uint64_t)h.mean())
+        << " p50=" << us(h.percentile(0.50))
+        << " p99=" << us(h.percentile(0.99))
+        << " p99.9=" << us(h.percentile(0.999))
+        << " max=" << us(h.max()) << "\n"
+        << "lost messages:      " << lost << "\n"
+        << "reordered messages: " << reordered << std::endl;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file line_framer.hpp
+ * @brief Incremental "\n" line framer for stream sockets.
+ *
+ * TCP delivers a byte stream, not messages: one recv() may return several
+ * lines, half a line, or a line split at any byte. LineFramer collects the
+ * bytes and hands out complete lines as std::string_view slices of its own
+ * buffer, so no line is copied on the way to the caller.
+ *
+ * Typical use:
+ *
+ *     LineFramer framer;
+ *     char *dst = framer.writePtr();   // Call before writable(): it may grow
+ *     ssize_t n = recv(fd, dst, framer.writable(), 0);
+ *     framer.commit(n);
+ *     std::string_view line;
+ *     while (framer.nextLine(line)) { ... }
+ *
+ * The buffer is a growable ring: consumed bytes are reclaimed by sliding the
+ * partial tail back to the front (instead of wrapping around), which keeps
+ * every line contiguous. Capacity only doubles when a single unfinished line
+ * no longer fits.
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstring>   // For memchr() / memmove()
+#include <cstddef>
+
+class LineFramer {
+public:
+    /**
+     * @param initialCapacity Starting buffer size in bytes.
+     * @param maxLineLength Longest line that is buffered before it is handed
+     *        out as-is (protects against peers that never send "\n").
+     */
+    explicit LineFramer(size_t initialCapacity = 4096, size_t maxLineLength = 1 << 20)
+        : buf(initialCapacity ? initialCapacity : 1), maxLine(maxLineLength) {}
+
+    /**
+     * @brief Returns where the next recv() should write.
+     * Guarantees at least minFree writable bytes, compacting or growing first.
+     * Lines returned earlier by nextLine() are invalidated by this call.
+     * Call it before writable() (not in the same argument list: evaluation
+     * order is unspecified there).
+     */
+    char *writePtr(size_t minFree = 1024) {
+        if (buf.size() - tail < minFree) makeRoom(minFree);
+        return buf.data() + tail;
+    }
+
+    /**
+     * @brief Number of bytes that may be written at writePtr().
+     */
+    size_t writable() const { return buf.size() - tail; }
+
+    /**
+     * @brief Marks n bytes written at writePtr() as received.
+     */
+    void commit(size_t n) { tail += n; }
+
+    /**
+     * @brief Convenience wrapper for data that is already in memory.
+     */
+    void append(const char *data, size_t n) {
+        std::memcpy(writePtr(n), data, n);
+        commit(n);
+    }
+
+    /**
+     * @brief Extracts the next complete line.
+     * The "\n" terminator and an optional preceding "\r" are stripped. The
+     * view stays valid until the next writePtr()/append() call.
+     * @return true if a line was produced, false if only a partial tail is left.
+     */
+    bool nextLine(std::string_view &line) {
+        const char *base = buf.data();
+        const char *nl = static_cast<const char*>(
+            std::memchr(base + scan, '\n', tail - scan));
+
+        if (!nl) {
+            // Remember how far we looked so the tail is never scanned twice.
+            scan = tail;
+            if (tail - head < maxLine) return false;
+            // Oversized line: deliver what we have rather than grow forever.
+            line = std::string_view(base + head, tail - head);
+            head = scan = tail;
+            return true;
+        }
+
+        size_t end = nl - base;
+        size_t len = end - head;
+        if (len > 0 && base[end - 1] == '\r') --len;
+        line = std::string_view(base + head, len);
+        head = scan = end + 1;
+        return true;
+    }
+
+    /**
+     * @brief The unterminated bytes received after the last complete line.
+     */
+    std::string_view pending() const {
+        return std::string_view(buf.data() + head, tail - head);
+    }
+
+    /**
+     * @brief Drops the partial tail (after the caller has handled pending()).
+     */
+    void discardPending() { head = scan = tail; }
+
+    /**
+     * @brief Number of buffered bytes not yet returned as lines.
+     */
+    size_t buffered() const { return tail - head; }
+
+    /**
+     * @brief Forgets everything buffered (e.g. after a reconnect).
+     */
+    void clear() { head = scan = tail = 0; }
+
+private:
+    std::vector<char> buf;
+    size_t head = 0;   // First byte not yet returned
+    size_t scan = 0;   // First byte not yet searched for "\n"
+    size_t tail = 0;   // One past the last received byte
+    size_t maxLine;
+
+    void makeRoom(size_t minFree) {
+        size_t live = tail - head;
+        if (head > 0) {
+            // Slide the partial line to the front; usually only a few bytes.
+            std::memmove(buf.data(), buf.data() + head, live);
+            scan -= head;
+            tail = live;
+            head = 0;
+        }
+        size_t need = live + minFree;
+        if (buf.size() < need) {
+            size_t cap = buf.size();
+            while (cap < need) cap *= 2;
+            buf.resize(cap);
+        }
+    }
+};
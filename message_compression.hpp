@@ -0,0 +1,163 @@
+/**
+ * @file message_compression.hpp
+ * @brief Per-message deflate with a preset chat dictionary ("+z").
+ *
+ * A client that asks for frames may also ask for compression:
+ * "LOGIN alice +bin +z" is answered with "LOGIN_OK +bin +z Welcome, alice".
+ * From then on the server may set FRAME_FLAG_DEFLATE on the TEXT frames it
+ * sends; their payload is the line as raw deflate data (RFC 1951, no zlib
+ * header or checksum) compressed against CHAT_DICTIONARY. Frames without the
+ * flag are plain, and client frames are always plain.
+ *
+ * Each message is compressed on its own, with no context carried over from
+ * the previous one. A per-connection stream would compress somewhat better,
+ * but its output would differ for every recipient; this way the server
+ * compresses a broadcast once and shares the frame between all "+z"
+ * recipients, as it already does for plain frames. The dictionary gives a
+ * short line the recurring protocol text to refer back to ("SERVER: ",
+ * " has joined the chat", ...). A line that would not shrink is sent plain.
+ *
+ * The stream names no dictionary, so CHAT_DICTIONARY must stay byte-identical
+ * to the copy in backend/server.js; a different dictionary needs a new
+ * capability token. Link with -lz.
+ */
+
+#pragma once
+
+#include <zlib.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "binary_frame.hpp" // For MAX_FRAME_PAYLOAD
+
+// zlib finds matches near the end of the dictionary most cheaply, so the
+// most frequent strings come last
+constexpr std::string_view CHAT_DICTIONARY =
+    "ERROR Usage: /msg <user> <text>ERROR No such user: ERROR Room names are "
+    " messages were skipped because your connection fell behind"
+    "PART_OK JOIN_OK HISTORY WHISPER to WHISPER from "
+    "sorry please thank you thanks what when where why how yes no okay ok sure "
+    "hello hi hey good morning night lol haha :) "
+    "is it that this have with for not are was you the and "
+    " has left #lobby has joined #lobby"
+    " has left the chatSERVER:  has joined the chatSERVER: ";
+
+/**
+ * @brief Frame bytes of a "+z" session: as they would have been plain, and
+ * as actually sent.
+ */
+struct CompressionStats {
+    uint64_t frames = 0;
+    uint64_t plainBytes = 0;
+    uint64_t sentBytes = 0;
+
+    void add(size_t plain, size_t sent) {
+        ++frames;
+        plainBytes += plain;
+        sentBytes += sent;
+    }
+
+    double ratio() const { return sentBytes ? (double)plainBytes / (double)sentBytes : 1.0; }
+
+    /**
+     * @brief "<frames> frames, <plain> -> <sent> bytes (<ratio>x)".
+     */
+    std::string describe() const {
+        char ratioText[32];
+        std::snprintf(ratioText, sizeof(ratioText), "%.2f", ratio());
+        return std::to_string(frames) + " frames, " + std::to_string(plainBytes) + " -> " +
+               std::to_string(sentBytes) + " bytes (" + ratioText + "x)";
+    }
+};
+
+/**
+ * @brief Deflates single messages against CHAT_DICTIONARY.
+ * Keeps one zlib stream and resets it per message, so compressing
+ * allocates nothing once the output string has grown.
+ */
+class MessageCompressor {
+public:
+    MessageCompressor() {
+        ok = deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    MessageCompressor(const MessageCompressor &) = delete;
+    MessageCompressor &operator=(const MessageCompressor &) = delete;
+    ~MessageCompressor() {
+        if (ok) deflateEnd(&z);
+    }
+
+    /**
+     * @brief Compresses text into out (replacing its contents).
+     * @return false if the result is not smaller than text; send it plain.
+     */
+    bool compress(std::string_view text, std::string &out) {
+        if (!ok || text.empty() || deflateReset(&z) != Z_OK ||
+            deflateSetDictionary(&z, reinterpret_cast<const Bytef*>(CHAT_DICTIONARY.data()),
+                                 (uInt)CHAT_DICTIONARY.size()) != Z_OK) {
+            return false;
+        }
+        out.resize(deflateBound(&z, (uLong)text.size()));
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+        z.avail_in = (uInt)text.size();
+        z.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        z.avail_out = (uInt)out.size();
+        if (deflate(&z, Z_FINISH) != Z_STREAM_END) return false;
+        out.resize(z.total_out);
+        return out.size() < text.size();
+    }
+
+private:
+    z_stream z{};
+    bool ok = false;
+};
+
+/**
+ * @brief Inflates FRAME_FLAG_DEFLATE payloads.
+ */
+class MessageDecompressor {
+public:
+    MessageDecompressor() { ok = inflateInit2(&z, -15) == Z_OK; }
+    MessageDecompressor(const MessageDecompressor &) = delete;
+    MessageDecompressor &operator=(const MessageDecompressor &) = delete;
+    ~MessageDecompressor() {
+        if (ok) inflateEnd(&z);
+    }
+
+    /**
+     * @brief Inflates payload into out (replacing its contents).
+     * @return false if the data is corrupt or inflates beyond MAX_FRAME_PAYLOAD.
+     */
+    bool decompress(std::string_view payload, std::string &out) {
+        // A raw stream takes its dictionary up front, right after the reset
+        if (!ok || inflateReset(&z) != Z_OK ||
+            inflateSetDictionary(&z, reinterpret_cast<const Bytef*>(CHAT_DICTIONARY.data()),
+                                 (uInt)CHAT_DICTIONARY.size()) != Z_OK) {
+            return false;
+        }
+        out.resize(payload.size() * 4 + 64);
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(payload.data()));
+        z.avail_in = (uInt)payload.size();
+        z.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        z.avail_out = (uInt)out.size();
+        while (true) {
+            int r = inflate(&z, Z_FINISH);
+            if (r == Z_STREAM_END) break;
+            if ((r != Z_BUF_ERROR && r != Z_OK) || z.avail_out != 0 || out.size() >= MAX_FRAME_PAYLOAD) {
+                return false; // Truncated or corrupt, or too large
+            }
+            // Output full: grow and carry on where inflate() stopped
+            size_t used = out.size() - z.avail_out;
+            out.resize(std::min<size_t>(out.size() * 2, MAX_FRAME_PAYLOAD));
+            z.next_out = reinterpret_cast<Bytef*>(&out[used]);
+            z.avail_out = (uInt)(out.size() - used);
+        }
+        out.resize(z.total_out);
+        return true;
+    }
+
+private:
+    z_stream z{};
+    bool ok = false;
+};
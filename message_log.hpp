@@ -0,0 +1,402 @@
+/**
+ * @file message_log.hpp
+ * @brief Append-only, segmented on-disk message log (server side).
+ *
+ * The log is a directory of preallocated segment files ("00000001.log",
+ * "00000002.log", ...). Each segment starts with a 16-byte header (magic
+ * "CHATLOG1" + the highest sequence number in the older segments, or 0)
+ * followed by records, then zeros up to the preallocated size. A record
+ * (all integers big-endian, like binary_frame.hpp):
+ *
+ *     offset  size  field
+ *     0       4     record size in bytes, header included (0 = end of segment)
+ *     4       4     CRC-32 of bytes [8, size)
+ *     8       8     broadcast sequence number
+ *     16      8     wall-clock time (milliseconds since the Unix epoch)
+ *     24      1     type (LOG_CHAT or LOG_NOTICE)
+ *     25      1     room name length r
+ *     26      2     reserved (0)
+ *     28      r     room name
+ *     28+r    ...   message line ("alice: hi"), up to the record size
+ *
+ * backend/server.js writes the same format.
+ *
+ * Reactors never touch the disk: append() encodes the record and hands it
+ * to the log's writer thread through an MpscQueue. Every sync interval the
+ * writer copies the queued records into the memory-mapped segment and then
+ * msync()s the whole batch at once (group commit). The cost is one syscall
+ * per interval, not one per message. A crash loses at most the last
+ * interval; killing the process only loses records still in the queue,
+ * because copied bytes already sit in the page cache.
+ *
+ * Every broadcast that takes a sequence number is logged, notices too, so
+ * the highest number ever issued survives a restart. On open, the newest
+ * segment is scanned up to the first record with a bad size or CRC. Any
+ * torn bytes after that point are zeroed and appending resumes there.
+ * lastSequence() lets the server continue its numbering: the highest of
+ * the segment's records and its header, or, for a segment without either
+ * (written before headers carried a sequence), of the older segments.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <dirent.h>    // For listing segment files
+#include <fcntl.h>     // For open() / posix_fallocate()
+#include <unistd.h>    // For close() / ftruncate()
+#include <sys/mman.h>  // For mmap() / msync()
+#include <sys/stat.h>  // For mkdir() / fstat()
+#include "mpsc_queue.hpp"
+
+constexpr size_t LOG_SEGMENT_HEADER = 16;
+constexpr size_t LOG_RECORD_HEADER = 28;
+constexpr char LOG_MAGIC[8] = {'C', 'H', 'A', 'T', 'L', 'O', 'G', '1'};
+
+enum LogRecordType : uint8_t {
+    LOG_CHAT = 1,  // A chat message broadcast to a room
+    LOG_NOTICE = 2 // A join / leave notice; logged for its sequence number
+};
+
+/**
+ * @brief One decoded record; the views point into the segment.
+ */
+struct LogRecord {
+    uint64_t seq = 0;
+    uint64_t timeMs = 0;
+    uint8_t type = LOG_CHAT;
+    std::string_view room;
+    std::string_view text;
+};
+
+/**
+ * @brief CRC-32 (IEEE, as used by zlib).
+ */
+inline uint32_t logCrc32(const char *data, size_t n, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/**
+ * @brief Appends one encoded record to out.
+ */
+inline void encodeLogRecord(std::string &out, uint64_t seq, uint64_t timeMs,
+                            std::string_view room, std::string_view text, uint8_t type = LOG_CHAT) {
+    if (room.size() > 255) room = room.substr(0, 255);
+    size_t start = out.size();
+    uint32_t size = (uint32_t)(LOG_RECORD_HEADER + room.size() + text.size());
+    out.resize(start + LOG_RECORD_HEADER);
+    char *h = &out[start];
+    for (int i = 0; i < 4; ++i) h[i] = (char)(size >> (24 - 8 * i));
+    for (int i = 0; i < 8; ++i) h[8 + i] = (char)(seq >> (56 - 8 * i));
+    for (int i = 0; i < 8; ++i) h[16 + i] = (char)(timeMs >> (56 - 8 * i));
+    h[24] = (char)type;
+    h[25] = (char)room.size();
+    h[26] = h[27] = 0;
+    out.append(room.data(), room.size());
+    out.append(text.data(), text.size());
+    uint32_t crc = logCrc32(out.data() + start + 8, size - 8);
+    for (int i = 0; i < 4; ++i) out[start + 4 + i] = (char)(crc >> (24 - 8 * i));
+}
+
+/**
+ * @brief Decodes the record at data[0..avail).
+ * @return The record size, or 0 at the end of the segment or on a torn record.
+ */
+inline size_t decodeLogRecord(const char *data, size_t avail, LogRecord &rec) {
+    if (avail < LOG_RECORD_HEADER) return 0;
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+    uint32_t size = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    if (size < LOG_RECORD_HEADER || size > avail || LOG_RECORD_HEADER + p[25] > size) return 0;
+    uint32_t crc = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+    if (logCrc32(data + 8, size - 8) != crc) return 0;
+    rec.seq = rec.timeMs = 0;
+    for (int i = 0; i < 8; ++i) rec.seq = rec.seq << 8 | p[8 + i];
+    for (int i = 0; i < 8; ++i) rec.timeMs = rec.timeMs << 8 | p[16 + i];
+    rec.type = p[24];
+    rec.room = std::string_view(data + LOG_RECORD_HEADER, p[25]);
+    rec.text = std::string_view(data + LOG_RECORD_HEADER + p[25], size - LOG_RECORD_HEADER - p[25]);
+    return size;
+}
+
+class MessageLog {
+public:
+    ~MessageLog() { close(); }
+
+    /**
+     * @brief Opens (or creates) the log; start() then starts the writer thread.
+     * @param segmentBytes Bytes preallocated per segment file.
+     * @param syncIntervalMs Group-commit interval.
+     * @return false with error set if the directory or a segment is unusable.
+     */
+    bool open(const std::string &directory, size_t segmentBytes, int syncIntervalMs, std::string &error) {
+        dir = directory;
+        segmentSize = segmentBytes;
+        syncInterval = std::chrono::milliseconds(syncIntervalMs > 0 ? syncIntervalMs : 1);
+        if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+            error = dir + ": " + strerror(errno);
+            return false;
+        }
+        uint32_t newest = newestSegment();
+        if (!mapSegment(newest ? newest : 1, error)) return false;
+        if (newest) recover();
+        writtenSeq = recoveredSeq;
+        openedSegment = segmentIndex;
+        return true;
+    }
+
+    /**
+     * @brief Starts the writer thread; appends queued before it are written
+     * first. Reading the log (forEachRecentRecord()) is only allowed before.
+     */
+    void start() {
+        if (running.exchange(true)) return;
+        writer = std::thread([this] { writerLoop(); });
+    }
+
+    /**
+     * @brief Highest sequence number in the log at open().
+     */
+    uint64_t lastSequence() const { return recoveredSeq; }
+
+    /**
+     * @brief Calls fn(record) for the records in the newest segments, oldest
+     * first, reading at most maxBytes of segments (always the newest one).
+     * @return false, reading nothing, once start() has run: the writer may
+     *         then be filling and switching segments.
+     */
+    template <typename Fn>
+    bool forEachRecentRecord(size_t maxBytes, Fn fn) const {
+        if (running.load()) return false;
+        uint32_t first = openedSegment;
+        struct stat st;
+        size_t bytes = stat(segmentPath(first).c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+        while (first > 1 && stat(segmentPath(first - 1).c_str(), &st) == 0 &&
+               bytes + (size_t)st.st_size <= maxBytes) {
+            bytes += (size_t)st.st_size;
+            --first;
+        }
+        for (uint32_t index = first; index <= openedSegment; ++index) scanSegment(index, fn);
+        return true;
+    }
+
+    /**
+     * @brief Queues one message; callable from any thread, never blocks.
+     */
+    void append(uint64_t seq, std::string_view room, std::string_view text, uint8_t type = LOG_CHAT) {
+        using namespace std::chrono;
+        uint64_t now = (uint64_t)duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        size_t maxText = segmentSize - LOG_SEGMENT_HEADER - LOG_RECORD_HEADER - std::min<size_t>(room.size(), 255);
+        if (text.size() > maxText) text = text.substr(0, maxText);
+        std::string record;
+        encodeLogRecord(record, seq, now, room, text, type);
+        pending.push(std::move(record));
+    }
+
+    /**
+     * @brief Writes out everything queued, syncs it and unmaps the segment.
+     */
+    void close() {
+        if (running.exchange(false)) writer.join();
+        unmapSegment();
+    }
+
+private:
+    std::string dir;
+    size_t segmentSize = 0;
+    std::chrono::milliseconds syncInterval{20};
+    MpscQueue<std::string> pending;  // Encoded records from the reactors
+    std::thread writer;
+    std::atomic<bool> running{false};
+    uint64_t recoveredSeq = 0;
+    uint32_t openedSegment = 0;      // Newest segment at open()
+
+    // Owned by the writer thread once it runs
+    uint32_t segmentIndex = 0;
+    int fd = -1;
+    char *map = nullptr;
+    size_t mappedSize = 0;   // Size of the current segment (>= segmentSize)
+    size_t offset = 0;       // Where the next record goes
+    size_t syncedTo = 0;     // Everything before this offset is on disk
+    uint64_t writtenSeq = 0; // Highest sequence written; the next segment's header
+
+    std::string segmentPath(uint32_t index) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/%08u.log", index);
+        return dir + name;
+    }
+
+    uint32_t newestSegment() const {
+        uint32_t newest = 0;
+        DIR *d = opendir(dir.c_str());
+        if (!d) return 0;
+        while (dirent *e = readdir(d)) {
+            unsigned index;
+            char tail[8];
+            if (sscanf(e->d_name, "%8u.%7s", &index, tail) == 2 && strcmp(tail, "log") == 0 &&
+                index > newest) newest = index;
+        }
+        closedir(d);
+        return newest;
+    }
+
+    bool mapSegment(uint32_t index, std::string &error) {
+        std::string path = segmentPath(index);
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) return failSegment(path, errno, error);
+        bool fresh = st.st_size == 0;
+        mappedSize = std::max(segmentSize, (size_t)st.st_size); // Existing segments keep their size
+        if ((size_t)st.st_size < mappedSize) {
+            // Reserve the blocks up front so appends never extend the file
+            int rc = posix_fallocate(fd, 0, (off_t)mappedSize);
+            if (rc != 0 && ftruncate(fd, (off_t)mappedSize) < 0) return failSegment(path, rc, error);
+        }
+        void *p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return failSegment(path, errno, error);
+        map = static_cast<char*>(p);
+        segmentIndex = index;
+        if (fresh) {
+            std::memcpy(map, LOG_MAGIC, sizeof(LOG_MAGIC));
+            for (int i = 0; i < 8; ++i) map[8 + i] = (char)(writtenSeq >> (56 - 8 * i));
+        }
+        offset = syncedTo = LOG_SEGMENT_HEADER;
+        return true;
+    }
+
+    bool failSegment(const std::string &path, int err, std::string &error) {
+        error = path + ": " + strerror(err);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    void unmapSegment() {
+        if (!map) return;
+        sync();
+        munmap(map, mappedSize);
+        ::close(fd);
+        map = nullptr;
+        fd = -1;
+    }
+
+    static uint64_t headerSequence(const char *segment) {
+        uint64_t seq = 0;
+        for (int i = 0; i < 8; ++i) seq = seq << 8 | (unsigned char)segment[8 + i];
+        return seq;
+    }
+
+    /**
+     * @brief Calls fn(record) for every valid record of a segment, read
+     * through a private read-only mapping.
+     * @return The segment's header sequence, or 0 if it cannot be read.
+     */
+    template <typename Fn>
+    uint64_t scanSegment(uint32_t index, Fn fn) const {
+        int in = ::open(segmentPath(index).c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (in < 0 || fstat(in, &st) < 0 || (size_t)st.st_size < LOG_SEGMENT_HEADER) {
+            if (in >= 0) ::close(in);
+            return 0;
+        }
+        size_t size = (size_t)st.st_size;
+        void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, in, 0);
+        ::close(in);
+        if (p == MAP_FAILED) return 0;
+        const char *data = static_cast<const char*>(p);
+        uint64_t base = std::memcmp(data, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0 ? headerSequence(data) : 0;
+        LogRecord rec;
+        for (size_t at = LOG_SEGMENT_HEADER; size_t n = decodeLogRecord(data + at, size - at, rec); at += n) fn(rec);
+        munmap(p, size);
+        return base;
+    }
+
+    /**
+     * @brief Finds the end of the newest segment and clears any torn tail.
+     */
+    void recover() {
+        LogRecord rec;
+        recoveredSeq = headerSequence(map);
+        while (size_t n = decodeLogRecord(map + offset, mappedSize - offset, rec)) {
+            if (rec.seq > recoveredSeq) recoveredSeq = rec.seq;
+            offset += n;
+        }
+        // An empty segment without a header sequence (an older format, or a
+        // switch that crashed): the numbering continues from the segments before
+        for (uint32_t index = segmentIndex - 1; recoveredSeq == 0 && index > 0; --index) {
+            uint64_t highest = 0;
+            uint64_t base = scanSegment(index, [&](const LogRecord &r) {
+                if (r.seq > highest) highest = r.seq;
+            });
+            recoveredSeq = std::max(base, highest);
+        }
+        // Pages after the end may have reached the disk before the page that
+        // holds it; make sure nothing stale can follow the next record.
+        for (size_t i = offset; i < mappedSize; ++i) {
+            if (map[i] != 0) {
+                std::memset(map + offset, 0, mappedSize - offset);
+                msync(map, mappedSize, MS_SYNC);
+                break;
+            }
+        }
+        syncedTo = offset;
+    }
+
+    void writerLoop() {
+        while (true) {
+            bool stopping = !running.load();
+            std::string record;
+            while (pending.pop(record)) write(record);
+            sync();
+            if (stopping) return;
+            std::this_thread::sleep_for(syncInterval);
+        }
+    }
+
+    void write(const std::string &record) {
+        if (!map) return; // Disabled after a failed segment switch
+        if (offset + record.size() > mappedSize) {
+            std::string error;
+            uint32_t next = segmentIndex + 1;
+            unmapSegment();
+            if (!mapSegment(next, error)) {
+                fprintf(stderr, "Message log disabled: %s\n", error.c_str());
+                return;
+            }
+        }
+        std::memcpy(map + offset, record.data(), record.size());
+        offset += record.size();
+        LogRecord rec;
+        if (decodeLogRecord(record.data(), record.size(), rec) && rec.seq > writtenSeq) writtenSeq = rec.seq;
+    }
+
+    /**
+     * @brief Group commit: one msync() for everything written since the last.
+     */
+    void sync() {
+        if (!map || syncedTo == offset) return;
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t from = syncedTo / page * page;
+        msync(map + from, offset - from, MS_SYNC);
+        syncedTo = offset;
+    }
+};
@@ -0,0 +1,67 @@
+/**
+ * @file mpsc_queue.hpp
+ * @brief Lock-free multi-producer / single-consumer queue (Vyukov style).
+ *
+ * Used by the multi-reactor server to hand broadcasts from the reactor that
+ * received a message to every other reactor. push() is wait-free (one
+ * atomic exchange plus one store) and may be called from any thread;
+ * pop() must only be called by the owning (consumer) thread. Items pushed
+ * by one producer are popped in the order they were pushed.
+ *
+ * A push that is still in progress may be invisible to pop() for a moment,
+ * so consumers pair the queue with a wake-up that the producer signals
+ * after push() returns (see Reactor::post in chat_server_linux.cpp).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(new Node()), tail(head.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T discard;
+        while (pop(discard)) {}
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    /**
+     * @brief Appends an item; safe to call from any number of threads.
+     */
+    void push(T value) {
+        Node *node = new Node();
+        node->value = std::move(value);
+        Node *prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Removes the oldest item. Consumer thread only.
+     * @return false if the queue is (momentarily) empty.
+     */
+    bool pop(T &out) {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        next->value = T();  // The node stays behind as the new stub
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node*> head;  // Most recently pushed node (producers)
+    Node *tail;               // Stub whose successor is the oldest item (consumer)
+};
@@ -0,0 +1,140 @@
+/**
+ * @file output_queue.hpp
+ * @brief Per-connection output queue of shared, immutable buffers (server side).
+ *
+ * A broadcast is serialized once into a SharedBuffer and the same bytes are
+ * handed to every recipient. Whatever a recipient's socket does not accept
+ * right away is queued as a reference (buffer + offset), never as a copy,
+ * so a storm of broadcasts to slow readers costs one allocation per message
+ * rather than one per recipient. The reference count is atomic, so buffers
+ * may also be shared between threads.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <cerrno>
+#include <sys/socket.h> // For send() / sendmsg()
+#include <sys/uio.h>    // For iovec
+
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+inline SharedBuffer makeSharedBuffer(std::string bytes) {
+    return std::make_shared<const std::string>(std::move(bytes));
+}
+
+class OutputQueue {
+public:
+    enum class Status {
+        Drained,   // Everything has been handed to the kernel
+        Blocked,   // Socket buffer full (EAGAIN); wait for EPOLLOUT
+        Error      // Hard socket error; the connection is unusable
+    };
+
+    /**
+     * @brief Sends buf now if nothing is queued, otherwise queues it behind
+     * the backlog. The unsent part is kept by reference.
+     */
+    Status write(int fd, const SharedBuffer &buf) {
+        if (!chunks.empty()) {
+            push(buf, 0);
+            return Status::Blocked;
+        }
+        ssize_t n;
+        do {
+            n = send(fd, buf->data(), buf->size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        } while (n < 0 && errno == EINTR);
+        if (n == (ssize_t)buf->size()) return Status::Drained;
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return Status::Error;
+            n = 0;
+        }
+        push(buf, (size_t)n);
+        return Status::Blocked;
+    }
+
+    /**
+     * @brief Retries the backlog (after EPOLLOUT), many chunks per sendmsg().
+     */
+    Status flush(int fd) {
+        while (!chunks.empty()) {
+            iovec iov[MAX_IOV];
+            int count = gather(iov, MAX_IOV);
+
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return Status::Blocked;
+                return Status::Error;
+            }
+            consume((size_t)n);
+        }
+        return Status::Drained;
+    }
+
+    /**
+     * @brief Queues buf without sending it (io_uring: the caller submits the
+     * send, see gather()).
+     */
+    void enqueue(const SharedBuffer &buf) { push(buf, 0); }
+
+    /**
+     * @brief Points iov at the first (up to max) unsent chunks, oldest first.
+     * The chunks stay alive until consume() drops them.
+     * @return Number of entries filled.
+     */
+    int gather(iovec *iov, int max) const {
+        int count = 0;
+        for (auto it = chunks.begin(); it != chunks.end() && count < max; ++it, ++count) {
+            iov[count].iov_base = const_cast<char*>(it->data->data()) + it->offset;
+            iov[count].iov_len = it->data->size() - it->offset;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Drops the first n bytes, which the kernel has accepted.
+     */
+    void consume(size_t n) {
+        queued -= n;
+        while (n > 0) {
+            Chunk &front = chunks.front();
+            size_t left = front.data->size() - front.offset;
+            if (n < left) {
+                front.offset += n; // Short write inside this chunk
+                return;
+            }
+            n -= left;
+            chunks.pop_front();
+        }
+    }
+
+    bool empty() const { return chunks.empty(); }
+    size_t bytesQueued() const { return queued; }
+
+    void clear() {
+        chunks.clear();
+        queued = 0;
+    }
+
+    // Chunks coalesced into one sendmsg() call (well below IOV_MAX)
+    static constexpr int MAX_IOV = 64;
+
+private:
+    struct Chunk {
+        SharedBuffer data;
+        size_t offset;   // Bytes of *data already sent
+    };
+    std::deque<Chunk> chunks;
+    size_t queued = 0;   // Unsent bytes across all chunks
+
+    void push(const SharedBuffer &buf, size_t offset) {
+        chunks.push_back(Chunk{buf, offset});
+        queued += buf->size() - offset;
+    }
+};
@@ -0,0 +1,42 @@
+/**
+ * @file reconnect_backoff.hpp
+ * @brief Jittered exponential backoff between reconnect attempts.
+ *
+ * Attempt k waits a random time in [d/2, d] with d = min(maxMs, baseMs * 2^k)
+ * ("equal jitter"). When a server restarts, its clients therefore spread
+ * their reconnects over the window instead of arriving all at once, while
+ * no client retries sooner than half the current delay.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+class ReconnectBackoff {
+public:
+    explicit ReconnectBackoff(uint32_t baseMs = 250, uint32_t maxMs = 30000)
+        : baseMs(baseMs), maxMs(maxMs), rng(std::random_device{}()) {}
+
+    /**
+     * @brief Delay before the next attempt; each call doubles the window.
+     */
+    uint32_t nextDelayMs() {
+        uint64_t window = (uint64_t)baseMs << (attempt < 20 ? attempt : 20);
+        if (window > maxMs) window = maxMs;
+        if (attempt < 20) ++attempt;
+        std::uniform_int_distribution<uint32_t> jitter((uint32_t)window / 2, (uint32_t)window);
+        return jitter(rng);
+    }
+
+    /**
+     * @brief Starts over from baseMs (after a successful login).
+     */
+    void reset() { attempt = 0; }
+
+private:
+    uint32_t baseMs;
+    uint32_t maxMs;
+    uint32_t attempt = 0;
+    std::mt19937 rng;
+};
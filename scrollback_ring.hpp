@@ -0,0 +1,127 @@
+/**
+ * @file scrollback_ring.hpp
+ * @brief Fixed-capacity ring of the most recent items (per-room scrollback).
+ *
+ * All slots are allocated when the ring is created. push() overwrites the
+ * oldest slot once the ring is full, so keeping history never allocates.
+ * The server stores shared pointers to broadcasts that already exist, which
+ * makes a push a reference-count increment. Broadcasts from several reactors
+ * can arrive out of order; pushOrdered() puts each one in its place, which
+ * costs a few swaps at most. ScrollbackRooms keeps one ring per room for a
+ * bounded number of rooms, dropping the least recently written room first.
+ * Each reactor owns its own rings and reads them on its own thread, between
+ * broadcasts, so replay needs no locking.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class ScrollbackRing {
+public:
+    explicit ScrollbackRing(size_t capacity) : slots(capacity) {}
+
+    /**
+     * @brief Appends an item, dropping the oldest one if the ring is full.
+     */
+    void push(T item) {
+        if (slots.empty()) return;
+        slots[next] = std::move(item);
+        next = (next + 1) % slots.size();
+        if (count < slots.size()) ++count;
+    }
+
+    /**
+     * @brief Inserts an item in order; before(a, b) tells whether a goes
+     * first. If the ring is full, the earliest item is dropped, or the new
+     * one if it would be the earliest.
+     */
+    template <typename Before>
+    void pushOrdered(T item, Before before) {
+        if (slots.empty()) return;
+        if (count == slots.size() && !before(at(0), item)) return;
+        push(std::move(item));
+        // Move it backwards past every item that should come after it
+        for (size_t i = count - 1; i > 0 && before(at(i), at(i - 1)); --i) {
+            std::swap(at(i), at(i - 1));
+        }
+    }
+
+    size_t size() const { return count; }
+
+    /**
+     * @brief Calls fn(item) for the stored items, oldest first.
+     */
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        size_t start = (next + slots.size() - count) % (slots.empty() ? 1 : slots.size());
+        for (size_t i = 0; i < count; ++i) fn(slots[(start + i) % slots.size()]);
+    }
+
+private:
+    // The i-th stored item, oldest first
+    T &at(size_t i) { return slots[(next + slots.size() - count + i) % slots.size()]; }
+
+    std::vector<T> slots;
+    size_t next = 0;   // Slot the next push() writes
+    size_t count = 0;  // Items stored (at most slots.size())
+};
+
+template <typename T>
+class ScrollbackRooms {
+public:
+    /**
+     * @param maxRooms Rooms kept; a new room beyond that evicts the least
+     * recently written one.
+     * @param capacity Items kept per room.
+     */
+    ScrollbackRooms(size_t maxRooms, size_t capacity) : maxRooms(maxRooms), capacity(capacity) {}
+
+    /**
+     * @brief Adds an item to a room's ring with ScrollbackRing::pushOrdered(),
+     * creating the ring (and evicting a room) if needed.
+     */
+    template <typename Before>
+    void pushOrdered(const std::string &room, T item, Before before) {
+        if (maxRooms == 0 || capacity == 0) return;
+        auto it = rooms.find(room);
+        if (it == rooms.end()) {
+            if (rooms.size() >= maxRooms) {
+                rooms.erase(recency.back());
+                recency.pop_back();
+            }
+            recency.push_front(room);
+            it = rooms.emplace(room, History{ScrollbackRing<T>(capacity), recency.begin()}).first;
+        } else {
+            recency.splice(recency.begin(), recency, it->second.recent);
+        }
+        it->second.ring.pushOrdered(std::move(item), before);
+    }
+
+    /**
+     * @brief The ring of a room, or nullptr if nothing was kept for it.
+     */
+    const ScrollbackRing<T> *find(const std::string &room) const {
+        auto it = rooms.find(room);
+        return it == rooms.end() ? nullptr : &it->second.ring;
+    }
+
+    size_t size() const { return rooms.size(); }
+
+private:
+    struct History {
+        ScrollbackRing<T> ring;
+        std::list<std::string>::iterator recent; // Its entry in recency
+    };
+
+    size_t maxRooms;
+    size_t capacity;
+    std::unordered_map<std::string, History> rooms;
+    std::list<std::string> recency; // Room names, most recently written first
+};
@@ -0,0 +1,112 @@
+/**
+ * @file send_queue.hpp
+ * @brief Non-blocking outbound message queue with "\n" framing.
+ *
+ * Every queued message is terminated with "\n" (server.js splits its input
+ * on newlines); pre-encoded binary frames bypass that via pushRaw().
+ * flush() hands as many queued messages as possible to the kernel in a
+ * single sendmsg() (scatter/gather, like writev), copes with short writes
+ * by remembering how much of the front message was sent, and returns
+ * instead of blocking when the socket buffer is full.
+ */
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <cerrno>
+#include <sys/socket.h> // For sendmsg()
+#include <sys/uio.h>    // For iovec
+
+class SendQueue {
+public:
+    enum class Status {
+        Drained,   // Everything queued has been handed to the kernel
+        Blocked,   // Socket buffer full (EAGAIN); retry when writable
+        Error      // Hard socket error; the connection is unusable
+    };
+
+    /**
+     * @brief Queues one message; the "\n" terminator is added here.
+     */
+    void push(std::string_view message) {
+        std::string framed;
+        framed.reserve(message.size() + 1);
+        framed.append(message.data(), message.size());
+        framed.push_back('\n');
+        queued += framed.size();
+        messages.push_back(std::move(framed));
+    }
+
+    /**
+     * @brief Queues bytes that are already framed (e.g. a binary frame) as-is.
+     */
+    void pushRaw(std::string bytes) {
+        queued += bytes.size();
+        messages.push_back(std::move(bytes));
+    }
+
+    /**
+     * @brief Sends queued data without blocking.
+     * @param fd Connected stream socket.
+     */
+    Status flush(int fd) {
+        while (!messages.empty()) {
+            iovec iov[MAX_IOV];
+            int count = 0;
+            for (auto it = messages.begin(); it != messages.end() && count < MAX_IOV; ++it, ++count) {
+                size_t skip = (count == 0) ? frontOffset : 0;
+                iov[count].iov_base = const_cast<char*>(it->data()) + skip;
+                iov[count].iov_len = it->size() - skip;
+            }
+
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            ssize_t n = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return Status::Blocked;
+                return Status::Error;
+            }
+            consume((size_t)n);
+        }
+        return Status::Drained;
+    }
+
+    bool empty() const { return messages.empty(); }
+    size_t bytesQueued() const { return queued; }
+    size_t messagesQueued() const { return messages.size(); }
+
+    /**
+     * @brief Drops everything still queued (e.g. after the connection died).
+     */
+    void clear() {
+        messages.clear();
+        frontOffset = 0;
+        queued = 0;
+    }
+
+private:
+    // Messages coalesced into one sendmsg() call (well below IOV_MAX)
+    static constexpr int MAX_IOV = 64;
+
+    std::deque<std::string> messages;
+    size_t frontOffset = 0;   // Bytes of messages.front() already sent
+    size_t queued = 0;        // Unsent bytes across all messages
+
+    void consume(size_t n) {
+        queued -= n;
+        while (n > 0) {
+            size_t left = messages.front().size() - frontOffset;
+            if (n < left) {
+                frontOffset += n; // Short write inside this message
+                return;
+            }
+            n -= left;
+            messages.pop_front();
+            frontOffset = 0;
+        }
+    }
+};
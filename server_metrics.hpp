@@ -0,0 +1,155 @@
+/**
+ * @file server_metrics.hpp
+ * @brief Server counters exported in the Prometheus text format (/metrics).
+ *
+ * Every reactor owns one ServerMetrics shard and is the only thread that
+ * writes it. An update is therefore a relaxed load and store (a plain add on
+ * x86), with no locked instruction and no cache line shared between reactors.
+ * A scrape reads every shard from its own thread and sums them
+ * (renderMetrics()); a value it reads may be a few updates old, but never torn.
+ *
+ * backend/metrics.js exports the same names, so dashboards work against
+ * either server. Rates such as logins per second come from the counters
+ * (rate(chat_logins_total[1m])), as is usual with Prometheus.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Monotonic counter with a single writer.
+ */
+class MetricCounter {
+public:
+    void add(uint64_t n = 1) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> v{0};
+};
+
+/**
+ * @brief Value that goes up and down, with a single writer.
+ */
+class MetricGauge {
+public:
+    void add(int64_t n = 1) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void sub(int64_t n = 1) { add(-n); }
+    int64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> v{0};
+};
+
+/**
+ * @brief Durations in fixed buckets, 1 µs to 100 ms (Prometheus histogram).
+ */
+class DurationHistogram {
+public:
+    static constexpr int BUCKETS = 16;
+    // Upper bounds in ns, and as printed in the "le" label (seconds)
+    static constexpr uint64_t BOUNDS_NS[BUCKETS] = {
+        1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+        500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000};
+    static constexpr const char *LABELS[BUCKETS] = {
+        "1e-06", "2.5e-06", "5e-06", "1e-05", "2.5e-05", "5e-05", "0.0001", "0.00025",
+        "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1"};
+
+    void observe(uint64_t ns) {
+        int i = 0;
+        while (i < BUCKETS && ns > BOUNDS_NS[i]) ++i;
+        counts[i].add(); // counts[BUCKETS]: above the last bound
+        sumNs.add(ns);
+    }
+
+    MetricCounter counts[BUCKETS + 1]; // Per bucket, not cumulative
+    MetricCounter sumNs;
+};
+
+/**
+ * @brief One reactor's counters (see the file comment for the threading rules).
+ */
+struct ServerMetrics {
+    MetricGauge connections;      // Open TCP connections
+    MetricGauge sessions;         // Logged-in sessions
+    MetricCounter logins;
+    MetricCounter messagesIn;     // Lines / frames received
+    MetricCounter messagesOut;    // Writes queued to clients (a reply with its scrollback is one)
+    MetricCounter bytesIn;
+    MetricCounter bytesOut;       // Handed to the kernel
+    MetricGauge queuedBytes;      // Waiting in output queues
+    MetricGauge congestedClients; // Above the high watermark
+    MetricCounter withheld;       // Broadcasts not sent to slow consumers
+    MetricCounter slowDisconnects;
+    MetricCounter compressedPlainBytes; // "+z" frames, as they would have been plain
+    MetricCounter compressedSentBytes;  // "+z" frames, as sent
+    DurationHistogram fanout;     // Delivering one broadcast to a room's members
+};
+
+namespace metrics_detail {
+
+inline void header(std::string &out, const char *name, const char *type, const char *help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+template <typename Metric>
+void sum(std::string &out, const std::vector<const ServerMetrics*> &shards, const char *name,
+         const char *type, const char *help, Metric ServerMetrics::*field) {
+    header(out, name, type, help);
+    long long total = 0;
+    for (const ServerMetrics *m : shards) total += (long long)(m->*field).value();
+    out.append(name).append(" ").append(std::to_string(total)).append("\n");
+}
+
+} // namespace metrics_detail
+
+/**
+ * @brief Sums the shards into a Prometheus text exposition (format 0.0.4).
+ */
+inline std::string renderMetrics(const std::vector<const ServerMetrics*> &shards) {
+    using metrics_detail::sum;
+    using SM = ServerMetrics;
+    std::string out;
+    sum(out, shards, "chat_connections", "gauge", "Open TCP connections.", &SM::connections);
+    sum(out, shards, "chat_sessions", "gauge", "Logged-in chat sessions.", &SM::sessions);
+    sum(out, shards, "chat_logins_total", "counter", "Successful logins.", &SM::logins);
+    sum(out, shards, "chat_messages_received_total", "counter", "Lines or frames received from clients.",
+        &SM::messagesIn);
+    sum(out, shards, "chat_messages_sent_total", "counter", "Messages queued to clients.", &SM::messagesOut);
+    sum(out, shards, "chat_bytes_received_total", "counter", "Bytes received from clients.", &SM::bytesIn);
+    sum(out, shards, "chat_bytes_sent_total", "counter", "Bytes written to client sockets.", &SM::bytesOut);
+    sum(out, shards, "chat_output_queue_bytes", "gauge", "Bytes waiting in client output queues.",
+        &SM::queuedBytes);
+    sum(out, shards, "chat_congested_clients", "gauge", "Clients above the output high watermark.",
+        &SM::congestedClients);
+    sum(out, shards, "chat_messages_dropped_total", "counter", "Broadcasts withheld from slow consumers.",
+        &SM::withheld);
+    sum(out, shards, "chat_slow_consumer_disconnects_total", "counter", "Clients disconnected for falling behind.",
+        &SM::slowDisconnects);
+    sum(out, shards, "chat_compression_plain_bytes_total", "counter",
+        "Frames sent to +z clients, counted as if uncompressed.", &SM::compressedPlainBytes);
+    sum(out, shards, "chat_compression_sent_bytes_total", "counter", "Frames sent to +z clients, as sent.",
+        &SM::compressedSentBytes);
+
+    const char *name = "chat_broadcast_fanout_seconds";
+    metrics_detail::header(out, name, "histogram", "Time to deliver one broadcast to a room's members.");
+    uint64_t cumulative = 0, sumNs = 0;
+    for (int i = 0; i <= DurationHistogram::BUCKETS; ++i) {
+        for (const ServerMetrics *m : shards) cumulative += m->fanout.counts[i].value();
+        out.append(name).append("_bucket{le=\"");
+        out.append(i < DurationHistogram::BUCKETS ? DurationHistogram::LABELS[i] : "+Inf");
+        out.append("\"} ").append(std::to_string(cumulative)).append("\n");
+    }
+    for (const ServerMetrics *m : shards) sumNs += m->fanout.sumNs.value();
+    char seconds[32];
+    std::snprintf(seconds, sizeof(seconds), "%.9f", sumNs / 1e9);
+    out.append(name).append("_sum ").append(seconds).append("\n");
+    out.append(name).append("_count ").append(std::to_string(cumulative)).append("\n");
+    return out;
+}
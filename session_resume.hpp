@@ -0,0 +1,140 @@
+/**
+ * @file session_resume.hpp
+ * @brief LOGIN capabilities for resuming a session after a reconnect.
+ *
+ *     "LOGIN alice +seq=<n> +room=<room>"
+ *
+ * "+seq=<n>" numbers the text protocol: every broadcast line is sent as
+ * "#<seq> <line>", with the same server-wide sequence that binary frames
+ * carry in their header. The scrollback replayed after LOGIN_OK then only
+ * holds messages after <n> (0 replays all of it). A reconnecting client
+ * passes the highest sequence it has seen, so a server restart costs every
+ * client only the messages it actually missed instead of a full history
+ * reload. Sequences only survive a restart when the server keeps a message
+ * log; if <n> is ahead of the server, the whole scrollback is replayed.
+ *
+ * "+room=<room>" logs straight into that room instead of DEFAULT_ROOM; the
+ * server then sends "JOIN_OK <room>" right after LOGIN_OK.
+ *
+ * An accepted "+seq" is echoed after LOGIN_OK, following "+bin" and "+z"
+ * (message_compression.hpp) if present: "LOGIN_OK +bin +z +seq Welcome, alice".
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "binary_frame.hpp" // For BINARY_CAPABILITY / COMPRESSION_CAPABILITY
+
+constexpr std::string_view SEQUENCE_CAPABILITY = "+seq";
+constexpr std::string_view ROOM_CAPABILITY = "+room=";
+
+/**
+ * @brief Capabilities found at the end of a LOGIN line.
+ */
+struct LoginCapabilities {
+    bool binary = false;     // "+bin"
+    bool compressed = false; // "+z" (only meaningful with "+bin")
+    bool numbered = false;   // "+seq=<n>"
+    uint64_t since = 0;      // <n> of "+seq=<n>"
+    std::string_view room;   // "+room=<room>" (not validated), empty if absent
+};
+
+/**
+ * @brief Parses a non-empty run of decimal digits.
+ */
+inline bool parseSequence(std::string_view digits, uint64_t &value) {
+    if (digits.empty() || digits.size() > 19) return false;
+    value = 0;
+    for (char ch : digits) {
+        if (ch < '0' || ch > '9') return false;
+        value = value * 10 + (uint64_t)(ch - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief Removes trailing capability tokens from a LOGIN argument.
+ * "alice smith +bin +seq=42" becomes "alice smith". Only well-formed
+ * tokens are stripped, so other names ending in "+something" are untouched.
+ */
+inline std::string_view stripLoginCapabilities(std::string_view name, LoginCapabilities &caps) {
+    caps = LoginCapabilities{};
+    constexpr std::string_view seqPrefix = "+seq=";
+    while (true) {
+        size_t sp = name.rfind(' ');
+        if (sp == std::string_view::npos) return name;
+        std::string_view token = name.substr(sp + 1);
+        if (token == BINARY_CAPABILITY) {
+            caps.binary = true;
+        } else if (token == COMPRESSION_CAPABILITY) {
+            caps.compressed = true;
+        } else if (token.substr(0, seqPrefix.size()) == seqPrefix &&
+                   parseSequence(token.substr(seqPrefix.size()), caps.since)) {
+            caps.numbered = true;
+        } else if (token.substr(0, ROOM_CAPABILITY.size()) == ROOM_CAPABILITY &&
+                   token.size() > ROOM_CAPABILITY.size()) {
+            caps.room = token.substr(ROOM_CAPABILITY.size());
+        } else {
+            return name;
+        }
+        name = name.substr(0, sp);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+    }
+}
+
+/**
+ * @brief Appends " +seq=<since> +room=<room>" to a LOGIN command.
+ * @param room Omitted if empty.
+ */
+inline void appendResumeCapabilities(std::string &cmd, uint64_t since, std::string_view room) {
+    cmd.append(" ").append(SEQUENCE_CAPABILITY).append("=").append(std::to_string(since));
+    if (!room.empty()) cmd.append(" ").append(ROOM_CAPABILITY).append(room);
+}
+
+/**
+ * @brief Reads the capabilities echoed by "LOGIN_OK +bin +z +seq Welcome, ...".
+ * @return The reply without them ("LOGIN_OK Welcome, ...").
+ */
+inline std::string stripAcceptedCapabilities(std::string_view reply, bool &binary, bool &numbered,
+                                             bool &compressed) {
+    constexpr std::string_view ok = "LOGIN_OK ";
+    binary = numbered = compressed = false;
+    if (reply.substr(0, ok.size()) != ok) return std::string(reply);
+    std::string_view rest = reply.substr(ok.size());
+    while (true) {
+        size_t sp = rest.find(' ');
+        if (sp == std::string_view::npos) break;
+        std::string_view token = rest.substr(0, sp);
+        if (token == BINARY_CAPABILITY) binary = true;
+        else if (token == SEQUENCE_CAPABILITY) numbered = true;
+        else if (token == COMPRESSION_CAPABILITY) compressed = true;
+        else break;
+        rest.remove_prefix(sp + 1);
+    }
+    std::string shown(ok);
+    shown.append(rest);
+    return shown;
+}
+
+/**
+ * @brief Appends "#<seq> " (the prefix of a numbered broadcast line).
+ */
+inline void appendSequencePrefix(std::string &out, uint64_t seq) {
+    out.push_back('#');
+    out.append(std::to_string(seq));
+    out.push_back(' ');
+}
+
+/**
+ * @brief Splits "#<seq> <line>" into seq and line.
+ * @return false (line untouched) if the line is not numbered.
+ */
+inline bool parseSequencePrefix(std::string_view &line, uint64_t &seq) {
+    if (line.empty() || line[0] != '#') return false;
+    size_t sp = line.find(' ');
+    if (sp == std::string_view::npos || !parseSequence(line.substr(1, sp - 1), seq)) return false;
+    line.remove_prefix(sp + 1);
+    return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file terminal_renderer.hpp
+ * @brief Batched terminal output for the Linux client.
+ *
+ * Instead of flushing std::cout for every received message, the client
+ * formats lines into one reusable buffer and writes everything that is ready
+ * with a single write(2). When messages arrive in bursts, flushes are spaced
+ * at least minInterval apart, so a busy room costs a bounded number of
+ * terminal writes per second no matter how many lines it produces.
+ *
+ * classifyLine() decides how a received line is displayed.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <iostream>  // For flushing std::cout before raw writes
+#include <cerrno>
+#include <unistd.h>  // For write()
+
+/**
+ * @brief How a received line is shown (the client colors each kind).
+ */
+enum class LineStyle {
+    Chat,    // "<user>: <text>" and anything unrecognized
+    Notice,  // "SERVER: ..."
+    Whisper  // "WHISPER to/from ..."
+};
+
+inline LineStyle classifyLine(std::string_view line) {
+    if (line.substr(0, 7) == "SERVER:") return LineStyle::Notice;
+    if (line.substr(0, 8) == "WHISPER ") return LineStyle::Whisper;
+    return LineStyle::Chat;
+}
+
+class TerminalRenderer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param outFd Descriptor to render to (normally stdout).
+     * @param minInterval Minimum time between two flushes (0 = no cap).
+     */
+    explicit TerminalRenderer(int outFd = STDOUT_FILENO,
+                              std::chrono::milliseconds minInterval = std::chrono::milliseconds(16))
+        : fd(outFd), interval(minInterval) {
+        buffer.reserve(64 * 1024);
+    }
+
+    /**
+     * @brief Adds text to the pending output; nothing is written yet.
+     */
+    void append(std::string_view text) { buffer.append(text.data(), text.size()); }
+
+    bool empty() const { return buffer.empty(); }
+
+    /**
+     * @brief Whether the refresh cap allows a flush right now.
+     */
+    bool due(Clock::time_point now = Clock::now()) const {
+        return now - lastFlush >= interval;
+    }
+
+    /**
+     * @brief Milliseconds until the next flush is allowed (0 if it already is).
+     */
+    int msUntilDue(Clock::time_point now = Clock::now()) const {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(lastFlush + interval - now);
+        return wait.count() > 0 ? (int)wait.count() + 1 : 0;
+    }
+
+    /**
+     * @brief Writes all pending output with as few write(2) calls as possible.
+     * std::cout is flushed first so earlier stream output keeps its order.
+     * @return false if the terminal could not be written.
+     */
+    bool flush() {
+        if (buffer.empty()) return true;
+        std::cout.flush();
+
+        size_t off = 0;
+        bool ok = true;
+        while (off < buffer.size()) {
+            ssize_t n = write(fd, buffer.data() + off, buffer.size() - off);
+            if (n > 0) {
+                off += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                ok = false; // Terminal gone; drop the output rather than spin
+                break;
+            }
+        }
+        buffer.clear(); // Keeps its capacity for the next batch
+        lastFlush = Clock::now();
+        return ok;
+    }
+
+private:
+    int fd;
+    std::chrono::milliseconds interval;
+    std::string buffer;
+    Clock::time_point lastFlush{};
+};
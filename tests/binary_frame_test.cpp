@@ -0,0 +1,100 @@
+/**
+ * @file binary_frame_test.cpp
+ * @brief Frame headers and FrameDecoder: partial headers, split payloads,
+ * the MAX_FRAME_PAYLOAD limit.
+ */
+
+#include <string>
+#include <string_view>
+#include "../binary_frame.hpp"
+#include "check.hpp"
+
+static void testHeaderRoundTrip() {
+    FrameHeader h;
+    h.length = 0x01020304;
+    h.type = FRAME_TEXT;
+    h.flags = FRAME_FLAG_DEFLATE;
+    h.sequence = 0x1122334455667788ull;
+    char bytes[FRAME_HEADER_SIZE];
+    encodeFrameHeader(bytes, h);
+    CHECK(bytes[0] == 0x01 && bytes[3] == 0x04 && bytes[6] == 0 && bytes[7] == 0);
+    CHECK((unsigned char)bytes[8] == 0x11 && (unsigned char)bytes[15] == 0x88);
+    FrameHeader back = decodeFrameHeader(bytes);
+    CHECK(back.length == h.length && back.type == h.type && back.flags == h.flags);
+    CHECK(back.sequence == h.sequence);
+}
+
+static void testWholeFrames() {
+    std::string stream;
+    appendFrame(stream, FRAME_TEXT, 7, "alice: hi");
+    appendFrame(stream, FRAME_TEXT, 8, "");
+    appendFrame(stream, FRAME_TEXT, 9, "two\nlines");
+    FrameDecoder decoder;
+    decoder.append(stream.data(), stream.size());
+    FrameHeader h;
+    std::string_view payload;
+    CHECK(decoder.next(h, payload) == FrameDecoder::Result::Frame);
+    CHECK(h.sequence == 7 && payload == "alice: hi");
+    CHECK(decoder.next(h, payload) == FrameDecoder::Result::Frame);
+    CHECK(h.sequence == 8 && payload.empty());
+    CHECK(decoder.next(h, payload) == FrameDecoder::Result::Frame);
+    CHECK(h.sequence == 9 && payload == "two\nlines");
+    CHECK(decoder.next(h, payload) == FrameDecoder::Result::NeedMore);
+    CHECK(decoder.buffered() == 0);
+}
+
+static void testPartialHeaderAndPayload() {
+    std::string stream;
+    appendFrame(stream, FRAME_TEXT, 1, "hello there");
+    appendFrame(stream, FRAME_TEXT, 2, "second");
+    FrameDecoder decoder(FRAME_HEADER_SIZE);
+    FrameHeader h;
+    std::string_view payload;
+    std::string got;
+    // One byte at a time: every header and payload arrives in pieces
+    for (char ch : stream) {
+        decoder.append(&ch, 1);
+        while (decoder.next(h, payload) == FrameDecoder::Result::Frame) {
+            got += std::to_string(h.sequence) + ":" + std::string(payload) + ";";
+        }
+    }
+    CHECK(got == "1:hello there;2:second;");
+}
+
+static void testPayloadLimit() {
+    std::string stream;
+    FrameHeader h;
+    h.length = MAX_FRAME_PAYLOAD;
+    char header[FRAME_HEADER_SIZE];
+    encodeFrameHeader(header, h);
+    stream.append(header, FRAME_HEADER_SIZE);
+    stream.append(MAX_FRAME_PAYLOAD, 'x');
+    FrameDecoder decoder;
+    decoder.append(stream.data(), stream.size());
+    std::string_view payload;
+    CHECK(decoder.next(h, payload) == FrameDecoder::Result::Frame);
+    CHECK(payload.size() == MAX_FRAME_PAYLOAD);
+
+    // One byte over the limit is refused from the header alone
+    h.length = MAX_FRAME_PAYLOAD + 1;
+    encodeFrameHeader(header, h);
+    decoder.append(header, FRAME_HEADER_SIZE);
+    CHECK(decoder.next(h, payload) == FrameDecoder::Result::Error);
+}
+
+static void testAcceptsBinaryFrames() {
+    CHECK(acceptsBinaryFrames("LOGIN_OK +bin Welcome, alice"));
+    CHECK(!acceptsBinaryFrames("LOGIN_OK Welcome, alice +bin"));
+    CHECK(!acceptsBinaryFrames("LOGIN_OK +binary Welcome"));
+    CHECK(!acceptsBinaryFrames("LOGIN_OK +bin"));
+    CHECK(!acceptsBinaryFrames("ERROR +bin x"));
+}
+
+int main() {
+    testHeaderRoundTrip();
+    testWholeFrames();
+    testPartialHeaderAndPayload();
+    testPayloadLimit();
+    testAcceptsBinaryFrames();
+    return checkFailures() != 0;
+}
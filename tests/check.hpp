@@ -0,0 +1,25 @@
+/**
+ * @file check.hpp
+ * @brief Minimal assertions for the unit tests (run by ctest).
+ *
+ * CHECK() reports a failed condition with its location and keeps going, so
+ * one run lists every failure; main() returns checkFailures() != 0.
+ */
+
+#pragma once
+
+#include <iostream>
+
+inline int &checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" \
+                      << std::endl;                                                   \
+            ++checkFailures();                                                        \
+        }                                                                             \
+    } while (0)
@@ -0,0 +1,123 @@
+/**
+ * @file line_framer_test.cpp
+ * @brief LineFramer: CRLF, lines split across reads, buffer growth.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../line_framer.hpp"
+#include "check.hpp"
+
+static std::vector<std::string> drain(LineFramer &framer) {
+    std::vector<std::string> lines;
+    std::string_view line;
+    while (framer.nextLine(line)) lines.emplace_back(line);
+    return lines;
+}
+
+static void testSeveralLinesInOneRead() {
+    LineFramer framer;
+    framer.append("a\nbb\n\nccc\n", 10);
+    std::vector<std::string> lines = drain(framer);
+    CHECK((lines == std::vector<std::string>{"a", "bb", "", "ccc"}));
+    CHECK(framer.buffered() == 0);
+}
+
+static void testCrlf() {
+    LineFramer framer;
+    framer.append("one\r\ntwo\r\n\r\n", 12);
+    CHECK((drain(framer) == std::vector<std::string>{"one", "two", ""}));
+    // A lone "\r" inside a line is data
+    framer.append("a\rb\n", 4);
+    CHECK((drain(framer) == std::vector<std::string>{"a\rb"}));
+}
+
+static void testSplitLines() {
+    LineFramer framer;
+    framer.append("hel", 3);
+    CHECK(drain(framer).empty());
+    CHECK(framer.pending() == "hel");
+    framer.append("lo\r", 3);
+    CHECK(drain(framer).empty());
+    framer.append("\nwor", 4);
+    CHECK((drain(framer) == std::vector<std::string>{"hello"}));
+    CHECK(framer.pending() == "wor");
+    framer.append("ld\n", 3);
+    CHECK((drain(framer) == std::vector<std::string>{"world"}));
+}
+
+static void testByteByByte() {
+    LineFramer framer(1);
+    std::string input = "first line\r\nsecond\n";
+    std::vector<std::string> lines;
+    for (char ch : input) {
+        framer.append(&ch, 1);
+        for (std::string &line : drain(framer)) lines.push_back(line);
+    }
+    CHECK((lines == std::vector<std::string>{"first line", "second"}));
+}
+
+static void testGrowthKeepsPartialLine() {
+    LineFramer framer(16);
+    std::string longLine(10000, 'x');
+    framer.append("short\n", 6);
+    for (size_t at = 0; at < longLine.size(); at += 700) {
+        size_t n = std::min<size_t>(700, longLine.size() - at);
+        framer.append(longLine.data() + at, n);
+        std::vector<std::string> lines = drain(framer);
+        if (at == 0) CHECK((lines == std::vector<std::string>{"short"}));
+        else CHECK(lines.empty());
+    }
+    framer.append("\n", 1);
+    std::vector<std::string> lines = drain(framer);
+    CHECK(lines.size() == 1 && lines[0] == longLine);
+}
+
+static void testWritePtrCompacts() {
+    LineFramer framer(64);
+    for (int i = 0; i < 100; ++i) {
+        char *dst = framer.writePtr(8);
+        CHECK(framer.writable() >= 8);
+        std::memcpy(dst, "line\nab", 7);
+        framer.commit(7);
+        std::vector<std::string> lines = drain(framer);
+        CHECK(lines.size() == 1 && lines[0] == (i == 0 ? "line" : "abline"));
+    }
+    // Consumed bytes were reclaimed instead of growing the buffer
+    CHECK(framer.pending() == "ab");
+    CHECK(framer.writable() < 64);
+}
+
+static void testOversizedLine() {
+    LineFramer framer(16, 32);
+    std::string junk(40, 'j');
+    framer.append(junk.data(), junk.size());
+    std::vector<std::string> lines = drain(framer);
+    CHECK(lines.size() == 1 && lines[0] == junk);
+    framer.append("ok\n", 3);
+    CHECK((drain(framer) == std::vector<std::string>{"ok"}));
+}
+
+static void testClear() {
+    LineFramer framer;
+    framer.append("partial", 7);
+    framer.clear();
+    CHECK(framer.buffered() == 0);
+    framer.append("next\n", 5);
+    CHECK((drain(framer) == std::vector<std::string>{"next"}));
+}
+
+int main() {
+    testSeveralLinesInOneRead();
+    testCrlf();
+    testSplitLines();
+    testByteByByte();
+    testGrowthKeepsPartialLine();
+    testWritePtrCompacts();
+    testOversizedLine();
+    testClear();
+    return checkFailures() != 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file message_compression_test.cpp
+ * @brief MessageCompressor / MessageDecompressor round trips and the
+ * MAX_FRAME_PAYLOAD limit on inflated payloads.
+ */
+
+#include <string>
+#include "../message_compression.hpp"
+#include "check.hpp"
+
+static void testRoundTrip() {
+    MessageCompressor compressor;
+    MessageDecompressor decompressor;
+    const std::string messages[] = {
+        "SERVER: alice has joined the chat",
+        "bob: hello everyone, how is it going this morning? good good",
+        "carol: " + std::string(5000, 'z'),
+    };
+    for (const std::string &text : messages) {
+        std::string deflated, inflated;
+        CHECK(compressor.compress(text, deflated));
+        CHECK(deflated.size() < text.size());
+        CHECK(decompressor.decompress(deflated, inflated));
+        CHECK(inflated == text);
+    }
+}
+
+static void testNotWorthIt() {
+    MessageCompressor compressor;
+    std::string out;
+    CHECK(!compressor.compress("", out));
+    CHECK(!compressor.compress("q", out)); // Not smaller: sent plain
+}
+
+static void testCorruptInput() {
+    MessageCompressor compressor;
+    MessageDecompressor decompressor;
+    std::string deflated, inflated;
+    CHECK(compressor.compress("dave: this message gets cut short in transit", deflated));
+    CHECK(!decompressor.decompress(deflated.substr(0, deflated.size() / 2), inflated));
+    CHECK(!decompressor.decompress("\xff\xff\xff\xff", inflated));
+    // The stream is reset per message, so a bad one does not poison the next
+    CHECK(decompressor.decompress(deflated, inflated));
+}
+
+static void testPayloadLimit() {
+    MessageCompressor compressor;
+    MessageDecompressor decompressor;
+    std::string deflated, inflated;
+    std::string largest(MAX_FRAME_PAYLOAD, 'a');
+    CHECK(compressor.compress(largest, deflated));
+    CHECK(decompressor.decompress(deflated, inflated));
+    CHECK(inflated.size() == MAX_FRAME_PAYLOAD);
+
+    // A small frame that would inflate past the limit is refused
+    std::string bomb(MAX_FRAME_PAYLOAD + 1, 'a');
+    CHECK(compressor.compress(bomb, deflated));
+    CHECK(deflated.size() < 4096);
+    CHECK(!decompressor.decompress(deflated, inflated));
+}
+
+int main() {
+    testRoundTrip();
+    testNotWorthIt();
+    testCorruptInput();
+    testPayloadLimit();
+    return checkFailures() != 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file message_log_test.cpp
+ * @brief Record encoding, MessageLog recovery (torn tails, empty newest
+ * segments) and the startup replay.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../message_log.hpp"
+#include "check.hpp"
+
+constexpr size_t SEGMENT = 4096;
+
+static std::vector<std::string> tempDirs;
+
+static std::string makeTempDir() {
+    char name[] = "/tmp/message_log_test.XXXXXX";
+    if (!mkdtemp(name)) return "";
+    tempDirs.push_back(name);
+    return name;
+}
+
+static std::string segmentFile(const std::string &dir, uint32_t index) {
+    char name[32];
+    snprintf(name, sizeof(name), "/%08u.log", index);
+    return dir + name;
+}
+
+static std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeAt(const std::string &path, size_t offset, const std::string &bytes) {
+    FILE *f = fopen(path.c_str(), "r+b");
+    if (!f) return;
+    fseek(f, (long)offset, SEEK_SET);
+    fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+}
+
+// Offset just past the last valid record of a segment file
+static size_t recordsEnd(const std::string &segment) {
+    size_t at = LOG_SEGMENT_HEADER;
+    LogRecord rec;
+    while (size_t n = decodeLogRecord(segment.data() + at, segment.size() - at, rec)) at += n;
+    return at;
+}
+
+// Writes seq first..last ("room<seq % 3>", chat lines with every 5th a notice)
+static void writeRecords(const std::string &dir, uint64_t first, uint64_t last) {
+    MessageLog log;
+    std::string error;
+    CHECK(log.open(dir, SEGMENT, 1, error));
+    log.start();
+    for (uint64_t seq = first; seq <= last; ++seq) {
+        log.append(seq, "room" + std::to_string(seq % 3), "user: message " + std::to_string(seq),
+                   seq % 5 == 0 ? LOG_NOTICE : LOG_CHAT);
+    }
+    log.close();
+}
+
+static uint64_t reopenedSequence(const std::string &dir) {
+    MessageLog log;
+    std::string error;
+    CHECK(log.open(dir, SEGMENT, 1, error));
+    return log.lastSequence();
+}
+
+static void testRecordRoundTrip() {
+    std::string out;
+    encodeLogRecord(out, 42, 1700000000000ull, "lobby", "alice: hi", LOG_CHAT);
+    encodeLogRecord(out, 43, 1700000000001ull, "dev", "SERVER: bob has joined #dev", LOG_NOTICE);
+    LogRecord rec;
+    size_t n = decodeLogRecord(out.data(), out.size(), rec);
+    CHECK(n == LOG_RECORD_HEADER + 5 + 9);
+    CHECK(rec.seq == 42 && rec.timeMs == 1700000000000ull && rec.type == LOG_CHAT);
+    CHECK(rec.room == "lobby" && rec.text == "alice: hi");
+    CHECK(decodeLogRecord(out.data() + n, out.size() - n, rec) == out.size() - n);
+    CHECK(rec.seq == 43 && rec.type == LOG_NOTICE && rec.room == "dev");
+
+    // Cut short, or with a flipped bit: not a record
+    CHECK(decodeLogRecord(out.data(), n - 1, rec) == 0);
+    std::string corrupt = out;
+    corrupt[LOG_RECORD_HEADER + 2] ^= 0x20;
+    CHECK(decodeLogRecord(corrupt.data(), corrupt.size(), rec) == 0);
+    // Zeros (the preallocated end of a segment) end the scan
+    std::string zeros(64, '\0');
+    CHECK(decodeLogRecord(zeros.data(), zeros.size(), rec) == 0);
+
+    // Room names are cut at 255 bytes
+    std::string longRoom;
+    encodeLogRecord(longRoom, 1, 0, std::string(300, 'r'), "x");
+    CHECK(decodeLogRecord(longRoom.data(), longRoom.size(), rec) != 0);
+    CHECK(rec.room.size() == 255 && rec.text == "x");
+}
+
+static void testSequenceAcrossSegments() {
+    std::string dir = makeTempDir();
+    writeRecords(dir, 1, 200);
+    CHECK(reopenedSequence(dir) == 200);
+    // Segments switched; each new header carries the highest sequence before it
+    std::string second = readFile(segmentFile(dir, 2));
+    CHECK(second.size() >= SEGMENT && second.compare(0, 8, LOG_MAGIC, 8) == 0);
+    uint64_t base = 0;
+    for (int i = 0; i < 8; ++i) base = base << 8 | (unsigned char)second[8 + i];
+    LogRecord first;
+    CHECK(decodeLogRecord(second.data() + LOG_SEGMENT_HEADER, second.size() - LOG_SEGMENT_HEADER, first));
+    CHECK(base > 0 && first.seq == base + 1);
+    // Appending after a reopen continues in the newest segment
+    writeRecords(dir, 201, 210);
+    CHECK(reopenedSequence(dir) == 210);
+}
+
+static void testTornTail() {
+    std::string dir = makeTempDir();
+    writeRecords(dir, 1, 3);
+    std::string path = segmentFile(dir, 1);
+    size_t end = recordsEnd(readFile(path));
+    // Half a record, as after a crash in the middle of a write
+    std::string record;
+    encodeLogRecord(record, 4, 0, "lobby", "never finished");
+    writeAt(path, end, record.substr(0, record.size() / 2));
+    CHECK(reopenedSequence(dir) == 3);
+    std::string after = readFile(path);
+    CHECK(recordsEnd(after) == end);
+    CHECK(after.find_first_not_of('\0', end) == std::string::npos); // Torn bytes zeroed
+    // Appending resumes right after the last good record
+    writeRecords(dir, 4, 5);
+    CHECK(reopenedSequence(dir) == 5);
+    CHECK(recordsEnd(readFile(path)) > end);
+}
+
+static void testEmptyNewestSegment() {
+    // A newest segment with a header sequence but no records yet
+    std::string dir = makeTempDir();
+    writeRecords(dir, 1, 200);
+    uint32_t next = 1;
+    while (!readFile(segmentFile(dir, next + 1)).empty()) ++next;
+    ++next;
+    std::string header(LOG_MAGIC, 8);
+    for (int i = 0; i < 8; ++i) header += (char)(uint64_t(200) >> (56 - 8 * i));
+    { std::ofstream(segmentFile(dir, next), std::ios::binary) << header << std::string(SEGMENT, '\0'); }
+    CHECK(reopenedSequence(dir) == 200);
+
+    // Without a header sequence (older format): the older segments count
+    std::string empty(LOG_MAGIC, 8);
+    empty += std::string(8 + SEGMENT, '\0');
+    { std::ofstream(segmentFile(dir, next), std::ios::binary) << empty; }
+    CHECK(reopenedSequence(dir) == 200);
+    // ... even across several empty ones
+    { std::ofstream(segmentFile(dir, next + 1), std::ios::binary) << empty; }
+    CHECK(reopenedSequence(dir) == 200);
+}
+
+static void testRecentRecords() {
+    std::string dir = makeTempDir();
+    writeRecords(dir, 1, 200);
+    MessageLog log;
+    std::string error;
+    CHECK(log.open(dir, SEGMENT, 1, error));
+
+    // Everything, oldest first, notices included
+    std::vector<uint64_t> seqs;
+    size_t notices = 0;
+    CHECK(log.forEachRecentRecord(1 << 20, [&](const LogRecord &rec) {
+        seqs.push_back(rec.seq);
+        notices += rec.type == LOG_NOTICE;
+        CHECK(rec.room == "room" + std::to_string(rec.seq % 3));
+    }));
+    CHECK(seqs.size() == 200 && seqs.front() == 1 && seqs.back() == 200);
+    bool ordered = true;
+    for (size_t i = 1; i < seqs.size(); ++i) ordered = ordered && seqs[i] > seqs[i - 1];
+    CHECK(ordered);
+    CHECK(notices == 40);
+
+    // A budget below one segment still reads the newest one, and only it
+    std::vector<uint64_t> newest;
+    CHECK(log.forEachRecentRecord(1, [&](const LogRecord &rec) { newest.push_back(rec.seq); }));
+    CHECK(!newest.empty() && newest.size() < 200 && newest.back() == 200);
+
+    // Not once the writer runs
+    log.start();
+    size_t visited = 0;
+    CHECK(!log.forEachRecentRecord(1 << 20, [&](const LogRecord &) { ++visited; }));
+    CHECK(visited == 0);
+}
+
+int main() {
+    testRecordRoundTrip();
+    testSequenceAcrossSegments();
+    testTornTail();
+    testEmptyNewestSegment();
+    testRecentRecords();
+    for (const std::string &dir : tempDirs) std::filesystem::remove_all(dir);
+    return checkFailures() != 0;
+}
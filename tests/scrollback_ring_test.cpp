@@ -0,0 +1,96 @@
+/**
+ * @file scrollback_ring_test.cpp
+ * @brief ScrollbackRing ordering and overwrite, and the ScrollbackRooms LRU.
+ */
+
+#include <string>
+#include <vector>
+#include "../scrollback_ring.hpp"
+#include "check.hpp"
+
+static bool lower(int a, int b) { return a < b; }
+
+static std::vector<int> items(const ScrollbackRing<int> &ring) {
+    std::vector<int> out;
+    ring.forEach([&](int item) { out.push_back(item); });
+    return out;
+}
+
+static void testPush() {
+    ScrollbackRing<int> ring(3);
+    CHECK(ring.size() == 0 && items(ring).empty());
+    ring.push(1);
+    ring.push(2);
+    CHECK(items(ring) == std::vector<int>({1, 2}));
+    ring.push(3);
+    ring.push(4);
+    ring.push(5);
+    CHECK(ring.size() == 3 && items(ring) == std::vector<int>({3, 4, 5}));
+
+    // --scrollback 0 keeps nothing
+    ScrollbackRing<int> none(0);
+    none.push(1);
+    none.pushOrdered(2, lower);
+    CHECK(none.size() == 0 && items(none).empty());
+}
+
+static void testPushOrdered() {
+    // Broadcasts from other reactors overtaking each other
+    ScrollbackRing<int> ring(5);
+    for (int seq : {2, 1, 4, 3, 5}) ring.pushOrdered(seq, lower);
+    CHECK(items(ring) == std::vector<int>({1, 2, 3, 4, 5}));
+
+    // Full: a late item still newer than the oldest takes its place ...
+    ring.pushOrdered(7, lower);
+    ring.pushOrdered(6, lower);
+    CHECK(items(ring) == std::vector<int>({3, 4, 5, 6, 7}));
+    // ... one older than everything kept is dropped
+    ring.pushOrdered(1, lower);
+    CHECK(items(ring) == std::vector<int>({3, 4, 5, 6, 7}));
+
+    // Wrapped several times, arriving in reverse pairs
+    ScrollbackRing<int> wrapped(4);
+    for (int seq = 1; seq <= 20; seq += 2) {
+        wrapped.pushOrdered(seq + 1, lower);
+        wrapped.pushOrdered(seq, lower);
+    }
+    CHECK(items(wrapped) == std::vector<int>({17, 18, 19, 20}));
+}
+
+static void testRoomEviction() {
+    constexpr size_t MAX_ROOMS = 1024;
+    ScrollbackRooms<int> rooms(MAX_ROOMS, 2);
+    int seq = 0;
+    for (size_t i = 0; i < MAX_ROOMS; ++i) rooms.pushOrdered("room" + std::to_string(i), ++seq, lower);
+    CHECK(rooms.size() == MAX_ROOMS);
+    CHECK(rooms.find("room0") && rooms.find("room1023"));
+    CHECK(!rooms.find("elsewhere"));
+
+    // room0 was written again, so room1 is the least recent and goes first
+    rooms.pushOrdered("room0", ++seq, lower);
+    rooms.pushOrdered("new1", ++seq, lower);
+    CHECK(rooms.size() == MAX_ROOMS);
+    CHECK(!rooms.find("room1"));
+    const ScrollbackRing<int> *kept = rooms.find("room0");
+    CHECK(kept && items(*kept) == std::vector<int>({1, 1025}));
+    rooms.pushOrdered("new2", ++seq, lower);
+    CHECK(!rooms.find("room2") && rooms.find("new1") && rooms.find("room0"));
+
+    // An evicted room starts over with an empty ring
+    rooms.pushOrdered("room1", ++seq, lower);
+    kept = rooms.find("room1");
+    CHECK(kept && items(*kept) == std::vector<int>({seq}));
+    CHECK(!rooms.find("room3"));
+
+    // Nothing is kept without rooms or items
+    ScrollbackRooms<int> disabled(MAX_ROOMS, 0);
+    disabled.pushOrdered("lobby", 1, lower);
+    CHECK(disabled.size() == 0 && !disabled.find("lobby"));
+}
+
+int main() {
+    testPush();
+    testPushOrdered();
+    testRoomEviction();
+    return checkFailures() != 0;
+}
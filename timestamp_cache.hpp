@@ -0,0 +1,69 @@
+/**
+ * @file timestamp_cache.hpp
+ * @brief Cached wall-clock timestamp formatting ("HH:MM", "HH:MM:SS", "HH:MM:SS.mmm").
+ *
+ * localtime() and strftime() are comparatively expensive (localtime also
+ * takes the libc timezone lock), yet the "HH:MM" text only changes once a
+ * minute. formatTimestamp() converts to local time once per minute and
+ * reuses the cached bytes until the next minute boundary; seconds and
+ * milliseconds are derived arithmetically from the clock.
+ *
+ * The cache is thread_local, so any number of threads may call it without
+ * locking. Returned views point into that per-thread cache and stay valid
+ * until the same thread calls formatTimestamp() again.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>        // For localtime_r() / strftime()
+#include <string_view>
+
+enum class TimestampFormat {
+    Minutes,      // "HH:MM" (default chat display)
+    Seconds,      // "HH:MM:SS"
+    Milliseconds  // "HH:MM:SS.mmm" (latency / debug modes)
+};
+
+/**
+ * @brief Formats the given time (default: now) in local time.
+ * Local UTC offsets are whole minutes, so a new minute in UTC is also a new
+ * minute locally and the seconds field is simply epoch seconds modulo 60.
+ */
+inline std::string_view formatTimestamp(
+        TimestampFormat format = TimestampFormat::Minutes,
+        std::chrono::system_clock::time_point tp = std::chrono::system_clock::now()) {
+    struct Cache {
+        int64_t minute = INT64_MIN;  // Epoch minute the text below belongs to
+        char text[16] = {};          // "HH:MM" + room for ":SS.mmm"
+    };
+    thread_local Cache cache;
+
+    int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+    int64_t seconds = ms >= 0 ? ms / 1000 : (ms - 999) / 1000;
+    int64_t minute = seconds >= 0 ? seconds / 60 : (seconds - 59) / 60;
+
+    if (minute != cache.minute) {
+        // Minute boundary crossed: the only place local time is computed
+        std::time_t t = (std::time_t)seconds;
+        std::tm tmLocal;
+        localtime_r(&t, &tmLocal);
+        std::strftime(cache.text, sizeof(cache.text), "%H:%M", &tmLocal);
+        cache.minute = minute;
+    }
+    if (format == TimestampFormat::Minutes) return std::string_view(cache.text, 5);
+
+    int sec = (int)(seconds - minute * 60);
+    cache.text[5] = ':';
+    cache.text[6] = (char)('0' + sec / 10);
+    cache.text[7] = (char)('0' + sec % 10);
+    if (format == TimestampFormat::Seconds) return std::string_view(cache.text, 8);
+
+    int milli = (int)(ms - seconds * 1000);
+    cache.text[8] = '.';
+    cache.text[9] = (char)('0' + milli / 100);
+    cache.text[10] = (char)('0' + milli / 10 % 10);
+    cache.text[11] = (char)('0' + milli % 10);
+    return std::string_view(cache.text, 12);
+}
@@ -0,0 +1,45 @@
+/**
+ * @file unix_socket.hpp
+ * @brief Unix domain socket addresses, shared by the native server and the clients.
+ *
+ * Bots on the same host as the server can skip the TCP loopback stack by
+ * connecting to a Unix domain socket instead; the chat protocol over it is
+ * byte-for-byte the same. A path starting with "@" names a socket in the
+ * Linux abstract namespace ("@chat" is "\0chat" in sun_path): it needs no
+ * file, vanishes with the server, and is reachable only from the same
+ * network namespace.
+ */
+
+#pragma once
+
+#include <string>
+#include <cstddef>      // For offsetof()
+#include <cstring>      // For memcpy()
+#include <sys/socket.h>
+#include <sys/un.h>     // For sockaddr_un
+
+/**
+ * @brief Whether path names an abstract-namespace socket ("@name").
+ */
+inline bool isAbstractSocket(const std::string &path) {
+    return !path.empty() && path[0] == '@';
+}
+
+/**
+ * @brief Builds the address of a Unix socket path, or of "@name" in the
+ * abstract namespace.
+ * @param len Set to the address length to pass to bind() / connect().
+ * @return false if the path is empty or does not fit into sun_path.
+ */
+inline bool makeUnixAddress(const std::string &path, sockaddr_un &addr, socklen_t &len) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    bool abstract = isAbstractSocket(path);
+    // A filesystem path needs room for its terminating NUL; "@" alone names nothing
+    size_t size = abstract ? path.size() : path.size() + 1;
+    if (path.empty() || path == "@" || size > sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.data(), path.size());
+    if (abstract) addr.sun_path[0] = '\0'; // Abstract names are not NUL-terminated
+    len = (socklen_t)(offsetof(sockaddr_un, sun_path) + size);
+    return true;
+}
@@ -0,0 +1,353 @@
+/**
+ * @file uring.hpp
+ * @brief Minimal io_uring wrapper on raw syscalls (no liburing dependency).
+ *
+ * The socket loops use io_uring as an alternative to epoll (--io-uring):
+ *
+ * - Submissions are only queued in shared memory; a single io_uring_enter()
+ *   per loop iteration submits all of them and waits for completions. A
+ *   broadcast to N peers therefore costs one syscall, not N send() calls.
+ * - Multishot recv keeps one request armed per socket; every arriving chunk
+ *   produces a completion without a new submission.
+ * - Received data lands in a provided buffer ring (BufferRing): the kernel
+ *   picks a free buffer per chunk, so idle connections pin no memory, and
+ *   the buffer goes back to the ring as soon as the chunk is handled.
+ *
+ * Requires Linux 5.19 or later (multishot accept/recv, buffer rings). On
+ * older kernels init() fails and says why; epoll remains the default.
+ */
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>     // For mapping the rings
+#include <sys/socket.h>   // For msghdr
+#include <sys/syscall.h>  // For __NR_io_uring_*
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+inline int uringSetup(unsigned entries, io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+inline int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                      const void *arg = nullptr, size_t argSize = 0) {
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+inline int uringRegister(int fd, unsigned opcode, const void *arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+class IoUring {
+public:
+    IoUring() = default;
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+    ~IoUring() { close(); }
+
+    /**
+     * @brief Creates the ring. Must run on the thread that will use it.
+     * @param entries Submission queue size; the completion queue is 4x larger.
+     * @return false with error set if io_uring is unavailable.
+     */
+    bool init(unsigned entries, std::string &error) {
+        io_uring_params p{};
+        // Completions are only ever reaped by this thread, inside io_uring_enter()
+        p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        p.cq_entries = entries * 4;
+        ringFd = uringSetup(entries, &p);
+        if (ringFd < 0 && errno == EINVAL) {
+            // Kernels before 6.1 know neither flag
+            p = io_uring_params{};
+            p.flags = IORING_SETUP_CQSIZE;
+            p.cq_entries = entries * 4;
+            ringFd = uringSetup(entries, &p);
+        }
+        if (ringFd < 0) {
+            error = std::string("io_uring_setup: ") + strerror(errno);
+            return false;
+        }
+        if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP) ||
+            !(p.features & IORING_FEAT_EXT_ARG)) {
+            error = "io_uring: kernel too old";
+            close();
+            return false;
+        }
+
+        ringBytes = std::max(p.sq_off.array + p.sq_entries * sizeof(uint32_t),
+                             p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+        ringMem = mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd, IORING_OFF_SQ_RING);
+        sqeBytes = p.sq_entries * sizeof(io_uring_sqe);
+        sqeMem = mmap(nullptr, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd, IORING_OFF_SQES);
+        if (ringMem == MAP_FAILED || sqeMem == MAP_FAILED) {
+            error = std::string("io_uring mmap: ") + strerror(errno);
+            close();
+            return false;
+        }
+
+        char *base = static_cast<char*>(ringMem);
+        sqHead = reinterpret_cast<uint32_t*>(base + p.sq_off.head);
+        sqTail = reinterpret_cast<uint32_t*>(base + p.sq_off.tail);
+        sqMask = *reinterpret_cast<uint32_t*>(base + p.sq_off.ring_mask);
+        sqEntries = p.sq_entries;
+        sqes = static_cast<io_uring_sqe*>(sqeMem);
+        // Slot i always holds SQE i, so the indirection array is filled once
+        uint32_t *array = reinterpret_cast<uint32_t*>(base + p.sq_off.array);
+        for (uint32_t i = 0; i < sqEntries; ++i) array[i] = i;
+        cqHead = reinterpret_cast<uint32_t*>(base + p.cq_off.head);
+        cqTail = reinterpret_cast<uint32_t*>(base + p.cq_off.tail);
+        cqMask = *reinterpret_cast<uint32_t*>(base + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + p.cq_off.cqes);
+        localTail = *sqTail;
+        return true;
+    }
+
+    void close() {
+        if (sqeMem && sqeMem != MAP_FAILED) munmap(sqeMem, sqeBytes);
+        if (ringMem && ringMem != MAP_FAILED) munmap(ringMem, ringBytes);
+        sqeMem = ringMem = nullptr;
+        if (ringFd >= 0) ::close(ringFd);
+        ringFd = -1;
+    }
+
+    int fd() const { return ringFd; }
+
+    /**
+     * @brief Next free submission slot, zeroed. Submits what is queued first
+     * if the submission queue is full.
+     * @return nullptr if the queue is still full because the kernel took
+     * none of it (e.g. -EBUSY until completions are reaped); the caller
+     * keeps the request and retries after the next wait.
+     */
+    io_uring_sqe *sqe() {
+        if (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+            if (submit() < 0 && localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+                return nullptr;
+            }
+        }
+        io_uring_sqe *s = &sqes[localTail & sqMask];
+        std::memset(s, 0, sizeof(*s));
+        ++localTail;
+        ++unsubmitted;
+        return s;
+    }
+
+    /**
+     * @brief Submits everything queued without waiting.
+     * @return 0 or -errno.
+     */
+    int submit() { return enter(0, nullptr); }
+
+    /**
+     * @brief Submits everything queued and waits for at least one completion.
+     * @param timeoutMs Give up waiting after this long (-1 = no limit).
+     * @return 0, -ETIME on timeout, or another -errno.
+     */
+    int submitAndWait(int timeoutMs = -1) {
+        if (timeoutMs < 0) return enter(1, nullptr);
+        __kernel_timespec ts{};
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+        return enter(1, &ts);
+    }
+
+    /**
+     * @brief Calls fn(cqe) for every available completion, then frees their slots.
+     * @return Number of completions handled.
+     */
+    template <typename Fn>
+    unsigned forEachCompletion(Fn fn) {
+        uint32_t h = *cqHead;
+        uint32_t t = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; h != t; ++h, ++count) {
+            fn(cqes[h & cqMask]);
+            // Free each slot at once: fn() may submit (and so complete) more
+            __atomic_store_n(cqHead, h + 1, __ATOMIC_RELEASE);
+        }
+        return count;
+    }
+
+    uint64_t enterCalls() const { return enters; }
+
+private:
+    int ringFd = -1;
+    void *ringMem = nullptr;
+    void *sqeMem = nullptr;
+    size_t ringBytes = 0;
+    size_t sqeBytes = 0;
+    uint32_t *sqHead = nullptr;
+    uint32_t *sqTail = nullptr;
+    uint32_t sqMask = 0;
+    uint32_t sqEntries = 0;
+    io_uring_sqe *sqes = nullptr;
+    uint32_t *cqHead = nullptr;
+    uint32_t *cqTail = nullptr;
+    uint32_t cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+    uint32_t localTail = 0;   // Next SQE to fill
+    uint32_t unsubmitted = 0; // Filled SQEs the kernel has not seen yet
+    uint64_t enters = 0;
+
+    int enter(unsigned waitFor, const __kernel_timespec *ts) {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        unsigned flags = waitFor ? IORING_ENTER_GETEVENTS : 0;
+        io_uring_getevents_arg arg{};
+        if (ts) {
+            arg.ts = (uint64_t)(uintptr_t)ts;
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+        while (true) {
+            ++enters;
+            int r = uringEnter(ringFd, unsubmitted, waitFor, flags, ts ? &arg : nullptr,
+                               ts ? sizeof(arg) : 0);
+            if (r >= 0) {
+                unsubmitted -= (unsigned)r;
+                return 0;
+            }
+            if (errno == EINTR && !waitFor) continue;
+            // EBUSY: completions overflowed; the caller reaps them and retries
+            return -errno;
+        }
+    }
+};
+
+/**
+ * @brief Provided buffer ring: receive buffers the kernel picks from.
+ */
+class BufferRing {
+public:
+    BufferRing() = default;
+    BufferRing(const BufferRing &) = delete;
+    BufferRing &operator=(const BufferRing &) = delete;
+    ~BufferRing() {
+        if (ring && ring != MAP_FAILED) munmap(ring, ringBytes);
+    }
+
+    /**
+     * @brief Registers count buffers of size bytes as buffer group `group`.
+     * @param count Power of two, at most 32768.
+     */
+    bool init(IoUring &uring, uint16_t group, unsigned count, unsigned size, std::string &error) {
+        bufferSize = size;
+        mask = count - 1;
+        storage.resize((size_t)count * size);
+        ringBytes = count * sizeof(io_uring_buf);
+        ring = static_cast<io_uring_buf_ring*>(
+            mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (ring == MAP_FAILED) {
+            error = std::string("buffer ring mmap: ") + strerror(errno);
+            return false;
+        }
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = (uint64_t)(uintptr_t)ring;
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (uringRegister(uring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            error = std::string("IORING_REGISTER_PBUF_RING: ") + strerror(errno);
+            return false;
+        }
+        for (unsigned i = 0; i < count; ++i) put((uint16_t)i, i);
+        publish(count);
+        return true;
+    }
+
+    const char *data(uint16_t bid) const { return storage.data() + (size_t)bid * bufferSize; }
+
+    /**
+     * @brief Hands a buffer back to the kernel once its data was handled.
+     */
+    void recycle(uint16_t bid) {
+        put(bid, 0);
+        publish(1);
+    }
+
+private:
+    io_uring_buf_ring *ring = nullptr;
+    size_t ringBytes = 0;
+    unsigned bufferSize = 0;
+    unsigned mask = 0;
+    uint16_t tail = 0;        // Our copy of ring->tail
+    std::vector<char> storage;
+
+    void put(uint16_t bid, unsigned offset) {
+        // Not ring->bufs: the kernel header declares it through an empty
+        // struct, which is 1 byte in C++ and moves the array by 8 bytes
+        io_uring_buf &b = reinterpret_cast<io_uring_buf*>(ring)[(tail + offset) & mask];
+        b.addr = (uint64_t)(uintptr_t)data(bid);
+        b.len = bufferSize;
+        b.bid = bid;
+    }
+
+    void publish(unsigned count) {
+        tail = (uint16_t)(tail + count);
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+};
+
+/**
+ * @brief Multishot recv into buffer group `group`: one completion per chunk,
+ * with IORING_CQE_F_MORE set while the request stays armed.
+ */
+inline void prepRecvMultishot(io_uring_sqe *s, int fd, uint16_t group, uint64_t userData) {
+    s->opcode = IORING_OP_RECV;
+    s->fd = fd;
+    s->ioprio = IORING_RECV_MULTISHOT;
+    s->flags = IOSQE_BUFFER_SELECT;
+    s->buf_group = group;
+    s->user_data = userData;
+}
+
+/**
+ * @brief Multishot accept: one completion (res = new fd) per connection.
+ */
+inline void prepAcceptMultishot(io_uring_sqe *s, int fd, uint32_t flags, uint64_t userData) {
+    s->opcode = IORING_OP_ACCEPT;
+    s->fd = fd;
+    s->ioprio = IORING_ACCEPT_MULTISHOT;
+    s->accept_flags = flags;
+    s->user_data = userData;
+}
+
+/**
+ * @brief sendmsg(); msg and everything it points to must stay valid until completion.
+ */
+inline void prepSendmsg(io_uring_sqe *s, int fd, const msghdr *msg, uint32_t flags, uint64_t userData) {
+    s->opcode = IORING_OP_SENDMSG;
+    s->fd = fd;
+    s->addr = (uint64_t)(uintptr_t)msg;
+    s->len = 1;
+    s->msg_flags = flags;
+    s->user_data = userData;
+}
+
+/**
+ * @brief Poll for events (POLLIN, POLLOUT...); multishot keeps it armed.
+ */
+inline void prepPoll(io_uring_sqe *s, int fd, uint32_t events, bool multishot, uint64_t userData) {
+    s->opcode = IORING_OP_POLL_ADD;
+    s->fd = fd;
+    s->poll32_events = events;
+    s->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    s->user_data = userData;
+}
+
+/**
+ * @brief Cancels the request submitted with user data `target`.
+ */
+inline void prepCancel(io_uring_sqe *s, uint64_t target, uint64_t userData) {
+    s->opcode = IORING_OP_ASYNC_CANCEL;
+    s->fd = -1;
+    s->addr = target;
+    s->user_data = userData;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file user_index.hpp
+ * @brief Username -> session hash index for direct messages (server side).
+ *
+ * Usernames are not unique: the same name may be logged in several times
+ * (for example a client that reconnects before its old connection has been
+ * noticed as gone). The index therefore keeps every session per name, in
+ * login order, and lookups return the most recent one. Removing a session
+ * leaves the other sessions of that name in place, so the index always
+ * matches who is actually logged in.
+ *
+ * Lookups are O(1) expected. The table is split into independently locked
+ * stripes so reactor threads only contend when they touch the same stripe;
+ * nothing here is on the broadcast path.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+template <typename Session>
+class UserIndex {
+public:
+    /**
+     * @brief Registers a session under name (after a successful LOGIN).
+     */
+    void add(const std::string &name, const Session &session) {
+        Stripe &s = stripeFor(name);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.users[name].push_back(session);
+    }
+
+    /**
+     * @brief Unregisters one session (on disconnect); other sessions of the
+     * same name stay reachable.
+     */
+    void remove(const std::string &name, const Session &session) {
+        Stripe &s = stripeFor(name);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.users.find(name);
+        if (it == s.users.end()) return;
+        std::vector<Session> &sessions = it->second;
+        sessions.erase(std::remove(sessions.begin(), sessions.end(), session), sessions.end());
+        if (sessions.empty()) s.users.erase(it);
+    }
+
+    /**
+     * @brief Finds the most recent session logged in as name.
+     * @return false if nobody of that name is logged in.
+     */
+    bool find(const std::string &name, Session &out) const {
+        const Stripe &s = stripeFor(name);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.users.find(name);
+        if (it == s.users.end()) return false;
+        out = it->second.back();
+        return true;
+    }
+
+private:
+    static constexpr size_t STRIPES = 16;
+
+    struct Stripe {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::vector<Session>> users;
+    };
+    Stripe stripes[STRIPES];
+
+    Stripe &stripeFor(const std::string &name) {
+        return stripes[std::hash<std::string>()(name) % STRIPES];
+    }
+    const Stripe &stripeFor(const std::string &name) const {
+        return stripes[std::hash<std::string>()(name) % STRIPES];
+    }
+};